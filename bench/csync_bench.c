@@ -0,0 +1,560 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "pool.h"
+#include "wait_group.h"
+#include "sharded_wait_group.h"
+#include "cond.h"
+#include "event.h"
+#include "mutex.h"
+#include "rwmutex.h"
+#include "map.h"
+#include "chan.h"
+
+/*!
+  * @brief the thread counts every benchmark is run with
+*/
+static const unsigned int bench_threads[] = {1, 2, 4, 8, 16, 32, 64};
+
+/*!
+  * @brief a benchmark that can be selected on the command line
+*/
+typedef struct bench {
+    const char *name;
+    void (*fn)(void);
+} bench_t;
+
+/*!
+  * @brief arguments shared by all threads of a benchmark run
+*/
+typedef struct bench_args {
+    void *data;
+    unsigned int iterations;
+    pthread_barrier_t barrier;
+} bench_args_t;
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*!
+  * @brief runs fn on num threads at once and returns the elapsed wall time in nanoseconds
+*/
+static double bench_run(unsigned int num, void *(*fn)(void *), bench_args_t *args) {
+    pthread_t *threads = calloc(num, sizeof(pthread_t));
+    pthread_barrier_init(&args->barrier, NULL, num + 1);
+    for (unsigned int i = 0; i < num; i++) {
+        pthread_create(&threads[i], NULL, fn, args);
+    }
+    // on machines with fewer cores than threads we may only be scheduled once the workers are done
+    double start = bench_now();
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < num; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = bench_now() - start;
+    pthread_barrier_destroy(&args->barrier);
+    free(threads);
+    return elapsed;
+}
+
+static void *bench_pool_alloc(void) {
+    return malloc(64);
+}
+
+/*!
+  * @brief borrows more objects than fit into the thread cache so every round goes through the shared tier
+*/
+static void *bench_pool_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    csync_pool_t *pool = (csync_pool_t *)args->data;
+    void *objs[CSYNC_POOL_LOCAL_SIZE * 2];
+
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        for (unsigned int j = 0; j < CSYNC_POOL_LOCAL_SIZE * 2; j++) {
+            objs[j] = csync_pool_get(pool);
+        }
+        for (unsigned int j = 0; j < CSYNC_POOL_LOCAL_SIZE * 2; j++) {
+            csync_pool_put(pool, objs[j]);
+        }
+    }
+    return NULL;
+}
+
+static void bench_pool(void) {
+    printf("pool: ns per get+put, %d objects borrowed per round\n", CSYNC_POOL_LOCAL_SIZE * 2);
+    printf("%8s %12s %12s\n", "threads", "mutex", "lockfree");
+    for (unsigned int i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        unsigned int num = bench_threads[i];
+        double results[2];
+        int flags[2] = {0, CSYNC_POOL_LOCKFREE};
+        for (int mode = 0; mode < 2; mode++) {
+            bench_args_t args;
+            args.iterations = 20000 / num + 1;
+            args.data = csync_pool_new_ex(128, bench_pool_alloc, free, flags[mode]);
+            double elapsed = bench_run(num, bench_pool_fn, &args);
+            results[mode] = elapsed / ((double)args.iterations * num * CSYNC_POOL_LOCAL_SIZE * 2);
+            csync_pool_destroy(args.data);
+        }
+        printf("%8u %12.1f %12.1f\n", num, results[0], results[1]);
+    }
+}
+
+static void *bench_wait_group_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        csync_wait_group_done(args->data);
+    }
+    return NULL;
+}
+
+static void *bench_sharded_wait_group_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        csync_sharded_wait_group_done(args->data);
+    }
+    return NULL;
+}
+
+/*!
+  * @brief every thread marks its share of one large count done at the same time, like tasks finishing together
+*/
+static void bench_wait_group(void) {
+    printf("wait_group: ns per done\n");
+    printf("%8s %12s %12s\n", "threads", "single", "sharded");
+    for (unsigned int i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        unsigned int num = bench_threads[i];
+        bench_args_t args;
+        args.iterations = 1000000 / num + 1;
+
+        csync_wait_group_t *wg = csync_wait_group_new(NULL);
+        csync_wait_group_add(wg, args.iterations * num);
+        args.data = wg;
+        double single = bench_run(num, bench_wait_group_fn, &args);
+        csync_wait_group_wait(wg);
+        free(wg);
+
+        csync_sharded_wait_group_t *sharded = csync_sharded_wait_group_new();
+        csync_sharded_wait_group_add(sharded, args.iterations * num);
+        args.data = sharded;
+        double elapsed = bench_run(num, bench_sharded_wait_group_fn, &args);
+        csync_sharded_wait_group_wait(sharded);
+        csync_sharded_wait_group_destroy(sharded);
+
+        double total = (double)args.iterations * num;
+        printf("%8u %12.1f %12.1f\n", num, single / total, elapsed / total);
+    }
+}
+
+/*!
+  * @brief the two sides of a ping pong between a pair of threads
+*/
+typedef struct bench_handoff {
+    csync_cond_t cond;
+    int turn;
+    csync_event_t ping;
+    csync_event_t pong;
+    _Atomic unsigned int next;
+} bench_handoff_t;
+
+static int bench_handoff_ping(void *arg) {
+    return ((bench_handoff_t *)arg)->turn == 1;
+}
+
+static int bench_handoff_pong(void *arg) {
+    return ((bench_handoff_t *)arg)->turn == 0;
+}
+
+static int bench_handoff_give_ping(void *arg) {
+    ((bench_handoff_t *)arg)->turn = 1;
+    return 1;
+}
+
+static int bench_handoff_give_pong(void *arg) {
+    ((bench_handoff_t *)arg)->turn = 0;
+    return 1;
+}
+
+static void *bench_handoff_cond_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_handoff_t *handoff = (bench_handoff_t *)args->data;
+    int first = atomic_fetch_add(&handoff->next, 1) == 0;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        if (first) {
+            csync_cond_locked(&handoff->cond, bench_handoff_give_ping, handoff);
+            csync_cond_wait_until(&handoff->cond, bench_handoff_pong, handoff);
+        } else {
+            csync_cond_wait_until(&handoff->cond, bench_handoff_ping, handoff);
+            csync_cond_locked(&handoff->cond, bench_handoff_give_pong, handoff);
+        }
+    }
+    return NULL;
+}
+
+static void *bench_handoff_event_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_handoff_t *handoff = (bench_handoff_t *)args->data;
+    int first = atomic_fetch_add(&handoff->next, 1) == 0;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        if (first) {
+            csync_event_set(&handoff->ping);
+            csync_event_wait(&handoff->pong);
+            csync_event_reset(&handoff->pong);
+        } else {
+            csync_event_wait(&handoff->ping);
+            csync_event_reset(&handoff->ping);
+            csync_event_set(&handoff->pong);
+        }
+    }
+    return NULL;
+}
+
+/*!
+  * @brief two threads hand control back and forth, the round trip time is twice the handoff latency
+*/
+static void bench_handoff(void) {
+    printf("handoff: ns per round trip between 2 threads\n");
+    printf("%8s %12s %12s %12s\n", "threads", "cond", "event", "event-park");
+    double results[3];
+    for (int mode = 0; mode < 3; mode++) {
+        bench_handoff_t handoff;
+        bench_args_t args;
+        csync_cond_new(&handoff.cond);
+        handoff.turn = 0;
+        csync_event_new(&handoff.ping);
+        csync_event_new(&handoff.pong);
+        if (mode == 2) {
+            csync_event_set_spins(&handoff.ping, 0);
+            csync_event_set_spins(&handoff.pong, 0);
+        }
+        atomic_init(&handoff.next, 0);
+        args.data = &handoff;
+        args.iterations = 100000;
+        double elapsed = bench_run(2, mode == 0 ? bench_handoff_cond_fn : bench_handoff_event_fn, &args);
+        results[mode] = elapsed / args.iterations;
+        pthread_cond_destroy(&handoff.cond.cond);
+        pthread_mutex_destroy(&handoff.cond.mutex);
+    }
+    printf("%8u %12.1f %12.1f %12.1f\n", 2, results[0], results[1], results[2]);
+}
+
+/*!
+  * @brief a counter behind either kind of lock
+*/
+typedef struct bench_lock {
+    pthread_mutex_t pthread;
+    csync_mutex_t mutex;
+    unsigned long counter;
+} bench_lock_t;
+
+static void *bench_pthread_mutex_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_lock_t *lock = (bench_lock_t *)args->data;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        pthread_mutex_lock(&lock->pthread);
+        lock->counter++;
+        pthread_mutex_unlock(&lock->pthread);
+    }
+    return NULL;
+}
+
+static void *bench_csync_mutex_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_lock_t *lock = (bench_lock_t *)args->data;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        csync_mutex_lock(&lock->mutex);
+        lock->counter++;
+        csync_mutex_unlock(&lock->mutex);
+    }
+    return NULL;
+}
+
+/*!
+  * @brief every thread increments a shared counter, the shortest critical section there is
+*/
+static void bench_mutex(void) {
+    printf("mutex: ns per lock+unlock\n");
+    printf("%8s %12s %12s\n", "threads", "pthread", "csync");
+    for (unsigned int i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        unsigned int num = bench_threads[i];
+        bench_lock_t lock;
+        bench_args_t args;
+        pthread_mutex_init(&lock.pthread, NULL);
+        csync_mutex_new(&lock.mutex);
+        lock.counter = 0;
+        args.data = &lock;
+        args.iterations = 1000000 / num + 1;
+        double total = (double)args.iterations * num;
+        double pthread = bench_run(num, bench_pthread_mutex_fn, &args) / total;
+        double csync = bench_run(num, bench_csync_mutex_fn, &args) / total;
+        pthread_mutex_destroy(&lock.pthread);
+        printf("%8u %12.1f %12.1f\n", num, pthread, csync);
+    }
+}
+
+/*!
+  * @brief a read-mostly table behind either kind of reader/writer lock
+*/
+typedef struct bench_rwlock {
+    pthread_rwlock_t pthread;
+    csync_rwmutex_t *rw;
+    unsigned long table[8];
+} bench_rwlock_t;
+
+static void *bench_pthread_rwlock_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_rwlock_t *lock = (bench_rwlock_t *)args->data;
+    unsigned long sum = 0;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        pthread_rwlock_rdlock(&lock->pthread);
+        sum += lock->table[i % 8];
+        pthread_rwlock_unlock(&lock->pthread);
+    }
+    return (void *)sum;
+}
+
+static void *bench_rwmutex_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_rwlock_t *lock = (bench_rwlock_t *)args->data;
+    unsigned long sum = 0;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        csync_rwmutex_rlock(lock->rw);
+        sum += lock->table[i % 8];
+        csync_rwmutex_runlock(lock->rw);
+    }
+    return (void *)sum;
+}
+
+/*!
+  * @brief every thread only reads, with linear scaling the total reads per microsecond grow with the number of cores
+*/
+static void bench_rwmutex(void) {
+    printf("rwmutex: total reads per us\n");
+    printf("%8s %12s %12s\n", "threads", "pthread", "csync");
+    for (unsigned int i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        unsigned int num = bench_threads[i];
+        bench_rwlock_t lock = {.table = {0}};
+        bench_args_t args;
+        pthread_rwlock_init(&lock.pthread, NULL);
+        lock.rw = csync_rwmutex_new();
+        args.data = &lock;
+        args.iterations = 1000000 / num + 1;
+        double total = (double)args.iterations * num * 1000;
+        double pthread = total / bench_run(num, bench_pthread_rwlock_fn, &args);
+        double csync = total / bench_run(num, bench_rwmutex_fn, &args);
+        pthread_rwlock_destroy(&lock.pthread);
+        csync_rwmutex_destroy(lock.rw);
+        printf("%8u %12.1f %12.1f\n", num, pthread, csync);
+    }
+}
+
+/*!
+  * @brief the number of keys in the map, writes keep it at roughly that size
+*/
+#define BENCH_MAP_KEYS 4096
+
+/*!
+  * @brief a map that is either used as is, or behind a single mutex, the setup it replaces
+*/
+typedef struct bench_map {
+    csync_map_t *map;
+    pthread_mutex_t mutex;
+    int locked;
+    unsigned int writes; /*! @brief writes per 1000 operations */
+    _Atomic unsigned int seed;
+} bench_map_t;
+
+/*!
+  * @brief looks up random keys, and instead replaces or deletes and re-adds one in writes of 1000 operations
+*/
+static void *bench_map_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_map_t *map = (bench_map_t *)args->data;
+    uint32_t x = atomic_fetch_add_explicit(&map->seed, 0x9e3779b9, memory_order_relaxed) | 1;
+    unsigned long found = 0;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        // xorshift32, so picking a key costs next to nothing
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        uintptr_t key = x % BENCH_MAP_KEYS + 1;
+        int write = x / BENCH_MAP_KEYS % 1000 < map->writes;
+        if (map->locked) {
+            pthread_mutex_lock(&map->mutex);
+        }
+        if (!write) {
+            found += csync_map_load(map->map, (void *)key, NULL);
+        } else if (i & 1) {
+            csync_map_store(map->map, (void *)key, (void *)key);
+        } else {
+            csync_map_delete(map->map, (void *)key, NULL);
+        }
+        if (map->locked) {
+            pthread_mutex_unlock(&map->mutex);
+        }
+    }
+    return (void *)found;
+}
+
+/*!
+  * @brief mixes lookups and writes from 50/50 to 99.9/0.1, reporting the total operations per microsecond
+*/
+static void bench_map(void) {
+    static const unsigned int writes[] = {500, 100, 10, 1};
+    for (unsigned int w = 0; w < sizeof(writes) / sizeof(writes[0]); w++) {
+        printf("map %.1f/%.1f reads/writes: total ops per us\n", (1000 - writes[w]) / 10.0, writes[w] / 10.0);
+        printf("%8s %12s %12s\n", "threads", "mutex", "csync");
+        for (unsigned int i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+            unsigned int num = bench_threads[i];
+            double result[2];
+            for (int locked = 1; locked >= 0; locked--) {
+                bench_map_t map = {.locked = locked, .writes = writes[w], .seed = 1};
+                bench_args_t args;
+                map.map = csync_map_new(NULL, NULL);
+                pthread_mutex_init(&map.mutex, NULL);
+                for (uintptr_t key = 1; key <= BENCH_MAP_KEYS; key++) {
+                    csync_map_store(map.map, (void *)key, (void *)key);
+                }
+                args.data = &map;
+                args.iterations = 1000000 / num + 1;
+                result[!locked] = (double)args.iterations * num * 1000 / bench_run(num, bench_map_fn, &args);
+                pthread_mutex_destroy(&map.mutex);
+                csync_map_destroy(map.map);
+            }
+            printf("%8u %12.1f %12.1f\n", num, result[0], result[1]);
+        }
+    }
+}
+
+/*!
+  * @brief the capacity of the channels the chan benchmark sends through
+*/
+#define BENCH_CHAN_CAP 1024
+
+/*!
+  * @brief a ring behind a mutex and two conditions, the queue csync_chan_t replaces
+*/
+typedef struct bench_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+    void *items[BENCH_CHAN_CAP];
+    unsigned long head;
+    unsigned long tail;
+} bench_queue_t;
+
+/*!
+  * @brief either kind of queue, the first half of the threads send and the second half receive
+*/
+typedef struct bench_chan {
+    bench_queue_t queue;
+    csync_chan_t *ch;
+    _Atomic unsigned int role;
+    unsigned int senders;
+} bench_chan_t;
+
+static void *bench_queue_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_chan_t *chan = (bench_chan_t *)args->data;
+    bench_queue_t *queue = &chan->queue;
+    int sender = atomic_fetch_add_explicit(&chan->role, 1, memory_order_relaxed) < chan->senders;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        pthread_mutex_lock(&queue->mutex);
+        if (sender) {
+            while (queue->head - queue->tail == BENCH_CHAN_CAP) {
+                pthread_cond_wait(&queue->not_full, &queue->mutex);
+            }
+            queue->items[queue->head++ % BENCH_CHAN_CAP] = queue;
+            pthread_cond_signal(&queue->not_empty);
+        } else {
+            while (queue->head == queue->tail) {
+                pthread_cond_wait(&queue->not_empty, &queue->mutex);
+            }
+            queue->tail++;
+            pthread_cond_signal(&queue->not_full);
+        }
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return NULL;
+}
+
+static void *bench_chan_fn(void *data) {
+    bench_args_t *args = (bench_args_t *)data;
+    bench_chan_t *chan = (bench_chan_t *)args->data;
+    int sender = atomic_fetch_add_explicit(&chan->role, 1, memory_order_relaxed) < chan->senders;
+    void *value = chan;
+    pthread_barrier_wait(&args->barrier);
+    for (unsigned int i = 0; i < args->iterations; i++) {
+        if (sender) {
+            csync_chan_send(chan->ch, value);
+        } else {
+            csync_chan_recv(chan->ch, &value);
+        }
+    }
+    return NULL;
+}
+
+/*!
+  * @brief as many senders as receivers pass values through a queue, reporting the total values per microsecond
+*/
+static void bench_chan(void) {
+    printf("chan: total values per us, threads are split into senders and receivers\n");
+    printf("%8s %12s %12s\n", "threads", "mutex+cond", "csync");
+    for (unsigned int i = 1; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        unsigned int num = bench_threads[i];
+        bench_chan_t chan = {.senders = 0};
+        bench_args_t args;
+        pthread_mutex_init(&chan.queue.mutex, NULL);
+        pthread_cond_init(&chan.queue.not_full, NULL);
+        pthread_cond_init(&chan.queue.not_empty, NULL);
+        chan.ch = csync_chan_new(BENCH_CHAN_CAP);
+        chan.senders = num / 2;
+        args.data = &chan;
+        args.iterations = 1000000 / chan.senders + 1;
+        double total = (double)args.iterations * chan.senders * 1000;
+        atomic_store(&chan.role, 0);
+        double queue = total / bench_run(num, bench_queue_fn, &args);
+        atomic_store(&chan.role, 0);
+        double csync = total / bench_run(num, bench_chan_fn, &args);
+        pthread_mutex_destroy(&chan.queue.mutex);
+        pthread_cond_destroy(&chan.queue.not_full);
+        pthread_cond_destroy(&chan.queue.not_empty);
+        csync_chan_destroy(chan.ch);
+        printf("%8u %12.1f %12.1f\n", num, queue, csync);
+    }
+}
+
+static const bench_t benches[] = {
+    {"pool", bench_pool},
+    {"wait_group", bench_wait_group},
+    {"handoff", bench_handoff},
+    {"mutex", bench_mutex},
+    {"rwmutex", bench_rwmutex},
+    {"map", bench_map},
+    {"chan", bench_chan},
+};
+
+int main(int argc, char **argv) {
+    for (unsigned int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (argc > 1 && strcmp(argv[1], benches[i].name) != 0) {
+            continue;
+        }
+        benches[i].fn();
+    }
+    return 0;
+}
\ No newline at end of file
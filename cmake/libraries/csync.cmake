@@ -9,3 +9,6 @@ target_link_libraries(csync pthread)
 add_executable(csync-test-c ./tests/csync_test.c)
 target_link_libraries(csync-test-c cmocka csync pthread)
 add_test(NAME CsyncTestC COMMAND csync-test-c)
+
+add_executable(csync-bench ./bench/csync_bench.c)
+target_link_libraries(csync-bench csync pthread)
@@ -0,0 +1,96 @@
+/*!
+  * @file bufpool.h
+  * @brief a pool of byte buffers of varying length, grouped into power of two size classes
+  * @details every size class is a csync_pool_t, so buffers are cached per thread like any other pooled object
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pool.h"
+
+/*!
+  * @brief the class index stored in front of buffers too large for any size class
+  * @details such buffers are allocated on demand and freed when they are put back
+*/
+#define CSYNC_BUFPOOL_OVERSIZE ((unsigned int)-1)
+
+/*!
+  * @brief a set of pools of byte buffers, one for every power of two between the minimum and maximum size
+  * @details class n holds buffers of min_size << n bytes, and a buffer is always taken from
+  * @details the smallest class large enough for the requested length
+  * @details every buffer is preceded by a small header recording its class, so csync_bufpool_put
+  * @details doesn't need to be told the length of the buffer
+  * @details like every csync_pool_t, the classes share a single thread key, so their number isn't bound by PTHREAD_KEYS_MAX
+*/
+typedef struct csync_bufpool {
+    csync_pool_t **classes; /*! @brief the pool of every size class */
+    _Atomic uint64_t *misses; /*! @brief buffers of every class allocated because the class had none stored */
+    unsigned int nclasses; /*! @brief the number of size classes */
+    unsigned int min_shift; /*! @brief log2 of the size of the smallest class */
+} csync_bufpool_t;
+
+/*!
+  * @brief intializes a buffer pool with size classes from min_size to max_size
+  * @param min_size the size of the smallest class, rounded up to a power of two
+  * @param max_size the size of the largest class, rounded up to a power of two
+  * @param cap the maximum number of idle buffers every class keeps in its shared tier, 0 for no limit
+  * @return Success: an initialized buffer pool
+  * @return Failure: NULL if memory couldn't be allocated or min_size is larger than max_size
+*/
+csync_bufpool_t *csync_bufpool_new(size_t min_size, size_t max_size, unsigned int cap);
+
+/*!
+  * @brief changes the capacity of the size class used for buffers of size bytes
+  * @details see csync_pool_set_cap, larger classes usually want a lower cap
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param size a buffer size, selecting the class like csync_bufpool_get
+  * @param cap the maximum number of idle buffers in the shared tier of the class, 0 for no limit
+  * @warning must be called before the buffer pool is used by other threads
+*/
+void csync_bufpool_set_cap(csync_bufpool_t *bufpool, size_t size, unsigned int cap);
+
+/*!
+  * @brief returns a buffer of at least min_len bytes
+  * @details the buffer comes from the smallest class holding min_len bytes, and lengths
+  * @details beyond the largest class are allocated directly instead of being pooled
+  * @details like objects of csync_pool_t, reused buffers are not zeroed
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param min_len the number of bytes needed
+  * @return Success: a buffer aligned for any type, use csync_bufpool_size for its actual length
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+void *csync_bufpool_get(csync_bufpool_t *bufpool, size_t min_len);
+
+/*!
+  * @brief returns a buffer back into the pool of its size class
+  * @param bufpool the instance of csync_bufpool_t the buffer was taken from
+  * @param buf a buffer returned by csync_bufpool_get, NULL is ignored
+  * @warning do not use the buffer after you have returned it to the pool
+*/
+void csync_bufpool_put(csync_bufpool_t *bufpool, void *buf);
+
+/*!
+  * @brief returns the usable length of a buffer returned by csync_bufpool_get
+*/
+size_t csync_bufpool_size(void *buf);
+
+/*!
+  * @brief takes a snapshot of the statistics of the size class used for buffers of size bytes
+  * @details the class pools never create buffers, so their misses are counted by the buffer pool and
+  * @details added to both misses and gets of the snapshot of the class, see csync_pool_stats
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param size a buffer size, selecting the class like csync_bufpool_get
+  * @param stats the snapshot is stored here, all zeros if size is larger than the largest class
+  * @note reports zeros when built with CSYNC_POOL_STATS set to 0
+*/
+void csync_bufpool_stats(csync_bufpool_t *bufpool, size_t size, csync_pool_stats_t *stats);
+
+/*!
+  * @brief frees all idle buffers and the pools of the size classes
+  * @warning do not use while any buffers are borrowed from the pool
+  * @warning do not use while other threads are still using the pool
+*/
+void csync_bufpool_destroy(csync_bufpool_t *bufpool);
\ No newline at end of file
@@ -0,0 +1,151 @@
+/*!
+  * @file chan.h
+  * @brief a bounded multi producer multi consumer channel of pointers
+  * @details is roughly equivalent to a buffered Golang channel, built on a ring of slots that each carry a sequence
+  * @details number, so senders and receivers only contend on the position counter of their own side, and blocked
+  * @details ones park on an eventcount, which costs the other side nothing as long as nobody is blocked
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "eventcount.h"
+#include "futex.h"
+
+/*!
+  * @brief the number of times a blocked send or receive retries before parking, if there is more than one cpu
+*/
+#ifndef CSYNC_CHAN_SPINS
+#define CSYNC_CHAN_SPINS 100
+#endif
+
+/*!
+  * @brief set in the send position once the channel is closed, positions count in steps of 2
+*/
+#define CSYNC_CHAN_CLOSED 1
+
+/*!
+  * @brief a slot of the ring
+  * @details seq equals the position of the send that may fill it next, and that position plus 1 once filled,
+  * @details receiving from it advances seq by the size of the ring, to the position of the next send using it
+*/
+typedef struct csync_chan_slot {
+    _Atomic size_t seq;
+    void *value;
+} csync_chan_slot_t;
+
+/*!
+  * @brief a bounded channel
+  * @details the send and receive sides are kept on cache lines of their own
+*/
+typedef struct csync_chan {
+    _Alignas(CSYNC_CACHE_LINE) _Atomic size_t head; /*! @brief the position of the next send shifted left by one, or'ed with CSYNC_CHAN_CLOSED */
+    _Alignas(CSYNC_CACHE_LINE) _Atomic size_t tail; /*! @brief the position of the next receive */
+    _Alignas(CSYNC_CACHE_LINE) csync_eventcount_t not_full; /*! @brief senders wait here while the channel is full */
+    _Atomic uint32_t full_woken; /*! @brief a woken sender hasn't retried yet, so a single wake can be left to it */
+    _Alignas(CSYNC_CACHE_LINE) csync_eventcount_t not_empty; /*! @brief receivers wait here while the channel is empty */
+    _Atomic uint32_t empty_woken; /*! @brief a woken receiver hasn't retried yet, so a single wake can be left to it */
+    _Alignas(CSYNC_CACHE_LINE) csync_chan_slot_t *slots;
+    size_t mask; /*! @brief the number of slots minus 1 */
+    unsigned int spins; /*! @brief the number of retries before parking */
+} csync_chan_t;
+
+/*!
+  * @brief returns a new channel that holds up to capacity values
+  * @details capacity is rounded up to a power of two of at least 2, there are no unbuffered channels
+  * @return Success: an initialized instance of csync_chan_t
+  * @return Failure: NULL if capacity is 0 or memory couldn't be allocated
+*/
+csync_chan_t *csync_chan_new(size_t capacity);
+
+/*!
+  * @brief sends value unless the channel is full or closed
+  * @return Success: 0
+  * @return Failure: EAGAIN if the channel is full, EPIPE if it is closed
+*/
+int csync_chan_try_send(csync_chan_t *ch, void *value);
+
+/*!
+  * @brief receives a value unless the channel is empty
+  * @details values sent before the channel was closed are still received after it
+  * @param ch an initialized instance of csync_chan_t
+  * @param value set to the received value
+  * @return Success: 0
+  * @return Failure: EAGAIN if the channel is empty, EPIPE if it is also closed
+*/
+int csync_chan_try_recv(csync_chan_t *ch, void **value);
+
+/*!
+  * @brief sends value, blocking while the channel is full
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is or gets closed
+*/
+int csync_chan_send(csync_chan_t *ch, void *value);
+
+/*!
+  * @brief like csync_chan_send, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ch an initialized instance of csync_chan_t
+  * @param value the value to send
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is or gets closed, ETIMEDOUT if it stayed full
+*/
+int csync_chan_send_until(csync_chan_t *ch, void *value, const struct timespec *abs);
+
+/*!
+  * @brief receives a value, blocking while the channel is empty
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is closed and all values sent before were received
+*/
+int csync_chan_recv(csync_chan_t *ch, void **value);
+
+/*!
+  * @brief like csync_chan_recv, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ch an initialized instance of csync_chan_t
+  * @param value set to the received value
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is closed and drained, ETIMEDOUT if it stayed empty
+*/
+int csync_chan_recv_until(csync_chan_t *ch, void **value, const struct timespec *abs);
+
+/*!
+  * @brief sends all num values in order, claiming as many slots at once as are free
+  * @details blocks while the channel is full, values of concurrent senders may be interleaved between batches
+  * @return the number of values sent, less than num only if the channel got closed
+*/
+size_t csync_chan_send_batch(csync_chan_t *ch, void *const *values, size_t num);
+
+/*!
+  * @brief receives up to num values, claiming as many slots at once as are filled
+  * @details blocks until at least one value is available, then returns what could be taken without blocking
+  * @return the number of values received, 0 only once the channel is closed and drained
+*/
+size_t csync_chan_recv_batch(csync_chan_t *ch, void **values, size_t num);
+
+/*!
+  * @brief closes the channel, failing all sends and waking every blocked sender and receiver
+  * @details receivers still get the values that were sent before
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel was already closed
+*/
+int csync_chan_close(csync_chan_t *ch);
+
+/*!
+  * @brief returns the number of values in the channel, which may be outdated by the time it returns
+*/
+size_t csync_chan_len(csync_chan_t *ch);
+
+/*!
+  * @brief returns the number of values the channel can hold
+*/
+size_t csync_chan_cap(csync_chan_t *ch);
+
+/*!
+  * @brief frees the channel, but not the values left in it
+  * @warning do not use while other threads are still using the channel
+*/
+void csync_chan_destroy(csync_chan_t *ch);
\ No newline at end of file
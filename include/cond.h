@@ -1,11 +1,18 @@
 /*!
   * @file cond.h
   * @brief a wrapper around pthread conditions
-  * @todo should we auotmatically determine whether or not to use signal/boradcast? recommended way of using pthread is if more than 1 thread is waiting use broadcast instead of signal and it would be neat if we can automatically delegate to the appropriate function
+  * @details the number of waiting threads is tracked, so notifying without waiters costs a single load
+  * @details and broadcasting to a single waiter is turned into a signal
 */
 
+#pragma once
+
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+#include "waitlist.h"
 
 /*!
   * @brief a wrapper around pthread condition variable that takes care of mutex locking/unlocking
@@ -13,8 +20,22 @@
 typedef struct csync_cond {
     pthread_cond_t cond;
     pthread_mutex_t mutex;
+    _Atomic unsigned int waiters; /*! @brief threads inside one of the wait functions, only changed with the mutex held */
+    csync_waitlist_t selects; /*! @brief threads waiting on this and other primitives through csync_select, added with the mutex held */
 } csync_cond_t;
 
+/*!
+  * @brief a condition checked by the csync_cond_wait_until family while the internal mutex is held
+  * @return non-zero once the condition holds
+*/
+typedef int (*csync_cond_pred_t)(void *arg);
+
+/*!
+  * @brief changes the state waited on while the internal mutex is held
+  * @return the number of waiters to wake up like csync_cond_notify_n, or a negative number to wake all of them
+*/
+typedef int (*csync_cond_fn_t)(void *arg);
+
 /*!
   * @brief will initialize the given csync_cond_t instance
   * @details do not use this function if you are initializing 
@@ -32,15 +53,91 @@ csync_cond_t *csync_cond_new(csync_cond_t *cond);
 
 /*!
  * @brief wrapper around pthread_cond_signal that handles locking and unlocking
+ * @details returns right away without taking the mutex if no thread is waiting
 */
 void csync_cond_signal(csync_cond_t *cond);
 
 /*!
   * @brief wrapper around pthread_cond_broadcast that handles locking/unlocking
+  * @details wakes every waiter; uses a signal when only one thread is waiting, and returns without taking the mutex when none are
 */
 void csync_cond_broadcast(csync_cond_t *cond);
 
 /*!
   * @brief wrapper around pthread_cond_wait that handles locking/unlocking
 */
-void csync_cond_wait(csync_cond_t *cond);
\ No newline at end of file
+void csync_cond_wait(csync_cond_t *cond);
+
+/*!
+  * @brief waits until pred(arg) returns non-zero
+  * @details pred is checked under the internal mutex before the first wait and after every wake up,
+  * @details so spurious wake ups are ignored and a change made through csync_cond_locked before we
+  * @details started waiting is never missed
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @warning pred must not call any other csync_cond function on cond
+*/
+void csync_cond_wait_until(csync_cond_t *cond, csync_cond_pred_t pred, void *arg);
+
+/*!
+  * @brief waits until pred(arg) returns non-zero, or until ns nanoseconds have passed
+  * @details like csync_cond_wait_until, the time is measured with the CLOCK_MONOTONIC clock
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @param ns the maximum time to wait for in nanoseconds
+  * @return Success: 0 if pred returned non-zero
+  * @return Failure: ETIMEDOUT if pred still returned 0 when the time was up
+*/
+int csync_cond_wait_until_timeout(csync_cond_t *cond, csync_cond_pred_t pred, void *arg, uint64_t ns);
+
+/*!
+  * @brief waits until pred(arg) returns non-zero, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details pred is checked one last time once abs passed, so a change that raced with the timeout is still reported
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at
+  * @return Success: 0 if pred returned non-zero
+  * @return Failure: ETIMEDOUT if pred still returned 0 at abs
+*/
+int csync_cond_wait_until_deadline(csync_cond_t *cond, csync_cond_pred_t pred, void *arg, const struct timespec *abs);
+
+/*!
+  * @brief wakes up to n of the waiting threads
+  * @details returns right away without taking the mutex if no thread is waiting, otherwise signals
+  * @details min(n, waiters) times, or broadcasts if that wakes all of them
+  * @details threads that were woken but haven't taken the mutex again yet still count as waiting
+  * @details threads in csync_select are always woken, on top of n, as they only recheck their predicate
+  * @param cond an initialized instance of csync_cond_t
+  * @param n the maximum number of threads to wake
+  * @return the number of threads that were woken
+  * @warning like a predicate wait, the state the waiters check must be changed before notifying
+*/
+unsigned int csync_cond_notify_n(csync_cond_t *cond, unsigned int n);
+
+/*!
+  * @brief calls fn(arg) with the internal mutex held and wakes as many waiters as it asks for
+  * @details changing the state and notifying under a single lock acquisition means a waiter checking
+  * @details its predicate either sees the change or is already waiting when the notification is sent
+  * @param cond an initialized instance of csync_cond_t
+  * @param fn changes the state, and returns how many waiters to wake
+  * @param arg passed through to fn
+*/
+void csync_cond_locked(csync_cond_t *cond, csync_cond_fn_t fn, void *arg);
+
+/*!
+  * @brief adds a csync_select node to the condition, unless pred(arg) already holds
+  * @details the node is added and pred checked under the internal mutex, so a change made through
+  * @details csync_cond_locked either shows up in pred or fires the node
+  * @return 1 if pred(arg) returned non-zero, in which case the node isn't added
+  * @note used by csync_select, which is what should be called instead
+*/
+int csync_cond_select_add(csync_cond_t *cond, csync_waitlist_node_t *node, csync_cond_pred_t pred, void *arg);
+
+/*!
+  * @brief removes a node added by csync_cond_select_add
+  * @note used by csync_select, which is what should be called instead
+*/
+void csync_cond_select_remove(csync_cond_t *cond, csync_waitlist_node_t *node);
\ No newline at end of file
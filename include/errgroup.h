@@ -0,0 +1,83 @@
+/*!
+  * @file errgroup.h
+  * @brief runs a group of tasks on their own threads and collects the first error any of them returns
+  * @details is roughly equivalent to Golang's errgroup.Group together with a cancelled context, the first
+  * @details failing task cancels the group, and waiting returns that error without waiting for the other tasks
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "wait_group.h"
+
+typedef struct csync_errgroup csync_errgroup_t;
+
+/*!
+  * @brief a task run by csync_errgroup_go
+  * @details long running tasks should poll csync_errgroup_cancelled and return early once it is set
+  * @return Success: 0
+  * @return Failure: any non-zero error, the first one cancels the group
+*/
+typedef int (*csync_errgroup_fn_t)(csync_errgroup_t *eg, void *arg);
+
+/*!
+  * @brief a set of tasks that fail together
+  * @details the wait group counts the task threads until they are done touching the group, so the group
+  * @details can be destroyed safely, while pending tells csync_errgroup_wait when all tasks have returned
+*/
+struct csync_errgroup {
+    csync_wait_group_t wg; /*! @brief task threads that may still access the group */
+    _Atomic int err; /*! @brief the first error returned by a task, or 0, a non-zero value means the group is cancelled */
+    _Atomic uint32_t pending; /*! @brief the number of tasks that haven't returned yet */
+    _Atomic uint32_t event; /*! @brief futex word bumped when the group is cancelled and when pending reaches 0 */
+};
+
+/*!
+  * @brief returns a new error group without any tasks
+  * @return Success: an initialized instance of csync_errgroup_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_errgroup_t *csync_errgroup_new(void);
+
+/*!
+  * @brief runs fn(eg, arg) on a new detached thread
+  * @details if fn returns a non-zero error and the group isn't cancelled yet, the error is recorded and the group is cancelled
+  * @param eg an initialized instance of csync_errgroup_t
+  * @param fn the task to run
+  * @param arg passed through to fn
+  * @return Success: 0
+  * @return Failure: ECANCELED if the group is already cancelled, the task isn't started
+  * @return Failure: an error of pthread_create, or ENOMEM, if the thread couldn't be started
+*/
+int csync_errgroup_go(csync_errgroup_t *eg, csync_errgroup_fn_t fn, void *arg);
+
+/*!
+  * @brief cancels the group with err, unless it is already cancelled
+  * @param eg an initialized instance of csync_errgroup_t
+  * @param err the error csync_errgroup_wait returns, 0 is replaced by ECANCELED
+*/
+void csync_errgroup_cancel(csync_errgroup_t *eg, int err);
+
+/*!
+  * @brief returns whether the group is cancelled
+  * @details a single relaxed load, so tasks can poll it in their inner loops
+*/
+static inline int csync_errgroup_cancelled(csync_errgroup_t *eg) {
+    return atomic_load_explicit(&eg->err, memory_order_relaxed) != 0;
+}
+
+/*!
+  * @brief waits until all tasks have returned, or until the group is cancelled
+  * @details the calling thread sleeps on a futex, so waiting doesn't take any cpu time away from the tasks
+  * @details tasks may still be running when this returns early with an error
+  * @return Success: 0 if all tasks returned 0
+  * @return Failure: the error the group was cancelled with
+*/
+int csync_errgroup_wait(csync_errgroup_t *eg);
+
+/*!
+  * @brief waits until every task thread is done with the group and frees it
+  * @details unlike csync_errgroup_wait this doesn't return early, cancel the group first to have the tasks stop
+*/
+void csync_errgroup_destroy(csync_errgroup_t *eg);
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*!
+  * @file event.h
+  * @brief a manual reset event for low latency handoffs between threads
+  * @details unlike csync_cond_t there is no mutex, setting an event nobody sleeps on is a single exchange,
+  * @details and a waiter spins for a while before it parks on a futex, so a handoff between two
+  * @details threads running on their own cpus usually doesn't involve the kernel at all
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/*!
+  * @brief the number of times csync_event_wait checks the event before parking, unless changed with csync_event_set_spins
+*/
+#ifndef CSYNC_EVENT_SPINS
+#define CSYNC_EVENT_SPINS 4000
+#endif
+
+/*!
+  * @brief the event isn't set and no thread is parked on it
+*/
+#define CSYNC_EVENT_UNSET 0
+
+/*!
+  * @brief the event is set, waiters return right away until it is reset
+*/
+#define CSYNC_EVENT_SET 1
+
+/*!
+  * @brief the event isn't set and at least one thread may be parked on it, so setting it has to wake them
+*/
+#define CSYNC_EVENT_PARKED 2
+
+/*!
+  * @brief an event that stays set until it is reset, waking every waiter when it is set
+*/
+typedef struct csync_event {
+    _Atomic uint32_t state; /*! @brief futex word holding CSYNC_EVENT_UNSET, CSYNC_EVENT_SET or CSYNC_EVENT_PARKED */
+    unsigned int spins; /*! @brief the number of times a waiter checks the event before parking */
+} csync_event_t;
+
+/*!
+  * @brief will initialize the given csync_event_t instance as unset
+  * @details waiters spin CSYNC_EVENT_SPINS times before parking, or not at all if only a single cpu is online
+  * @param ev a declared but uninitialized csync_event_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_event_t
+  * @return Failure (ev == NULL): NULL
+*/
+csync_event_t *csync_event_new(csync_event_t *ev);
+
+/*!
+  * @brief changes how many times waiters check the event before parking
+  * @details spinning longer lowers the latency of handoffs between busy threads at the cost of cpu time, 0 parks right away
+*/
+void csync_event_set_spins(csync_event_t *ev, unsigned int spins);
+
+/*!
+  * @brief sets the event and wakes every thread waiting for it
+  * @details the futex is only woken if a waiter parked, otherwise this is a single exchange
+*/
+void csync_event_set(csync_event_t *ev);
+
+/*!
+  * @brief resets the event so later waiters block again, does nothing if it isn't set
+  * @warning a parked waiter that didn't get to run between set and reset keeps waiting for the next set
+*/
+void csync_event_reset(csync_event_t *ev);
+
+/*!
+  * @brief returns whether the event is set
+*/
+int csync_event_is_set(csync_event_t *ev);
+
+/*!
+  * @brief waits until the event is set
+  * @details spins with a pause instruction first, and parks on the futex once the spins are used up
+*/
+void csync_event_wait(csync_event_t *ev);
+
+/*!
+  * @brief waits until the event is set, or until the CLOCK_MONOTONIC clock reaches abs
+  * @param ev an initialized instance of csync_event_t
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0 if the event is set
+  * @return Failure: ETIMEDOUT if the event wasn't set in time
+*/
+int csync_event_wait_until(csync_event_t *ev, const struct timespec *abs);
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*!
+  * @file eventcount.h
+  * @brief lets threads sleep until a lock-free data structure changes, without locks on the notifying side
+  * @details a consumer that found nothing announces itself with csync_eventcount_prepare_wait, checks the
+  * @details data structure once more, and then either commits to sleeping or cancels, a producer calls
+  * @details csync_eventcount_notify after publishing, which doesn't write anything if no consumer is waiting
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/*!
+  * @brief an eventcount, the epoch changes whenever waiters are notified
+*/
+typedef struct csync_eventcount {
+    _Atomic uint32_t epoch; /*! @brief futex word, incremented by every notify that finds waiters */
+    _Atomic uint32_t waiters; /*! @brief the number of threads between prepare_wait and commit_wait or cancel_wait */
+} csync_eventcount_t;
+
+/*!
+  * @brief will initialize the given csync_eventcount_t instance
+  * @param ec a declared but uninitialized csync_eventcount_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_eventcount_t
+  * @return Failure (ec == NULL): NULL
+*/
+csync_eventcount_t *csync_eventcount_new(csync_eventcount_t *ec);
+
+/*!
+  * @brief announces that the calling thread is about to wait
+  * @details the caller must check its condition again after this, and then call exactly one of
+  * @details csync_eventcount_cancel_wait if it holds, or csync_eventcount_commit_wait if it doesn't
+  * @return the key to pass to csync_eventcount_commit_wait
+*/
+uint32_t csync_eventcount_prepare_wait(csync_eventcount_t *ec);
+
+/*!
+  * @brief withdraws a csync_eventcount_prepare_wait call because the condition already holds
+*/
+void csync_eventcount_cancel_wait(csync_eventcount_t *ec);
+
+/*!
+  * @brief sleeps until a notify happens after the csync_eventcount_prepare_wait call that returned key
+  * @details returns right away if a notify already happened in between, so it can't be missed
+  * @param ec an initialized instance of csync_eventcount_t
+  * @param key the value returned by csync_eventcount_prepare_wait
+*/
+void csync_eventcount_commit_wait(csync_eventcount_t *ec, uint32_t key);
+
+/*!
+  * @brief like csync_eventcount_commit_wait, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ec an initialized instance of csync_eventcount_t
+  * @param key the value returned by csync_eventcount_prepare_wait
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0 if notified
+  * @return Failure: ETIMEDOUT if no notify happened in time
+*/
+int csync_eventcount_commit_wait_until(csync_eventcount_t *ec, uint32_t key, const struct timespec *abs);
+
+/*!
+  * @brief starts a new epoch and wakes up to num sleeping waiters
+  * @details the slow path of csync_eventcount_notify and csync_eventcount_notify_all
+*/
+void csync_eventcount_wake(csync_eventcount_t *ec, int num);
+
+/*!
+  * @brief wakes a single waiter, call it after publishing a change a waiter may be waiting for
+  * @details when nobody waits this is a fence and a single load, so producers don't share any written cache line
+*/
+static inline void csync_eventcount_notify(csync_eventcount_t *ec) {
+    // orders the publish before the load, pairs with the fence in csync_eventcount_prepare_wait
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ec->waiters, memory_order_relaxed) != 0) {
+        csync_eventcount_wake(ec, 1);
+    }
+}
+
+/*!
+  * @brief wakes every waiter, for example when the data structure is closed
+  * @details when nobody waits this is a fence and a single load, like csync_eventcount_notify
+*/
+static inline void csync_eventcount_notify_all(csync_eventcount_t *ec) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ec->waiters, memory_order_relaxed) != 0) {
+        csync_eventcount_wake(ec, INT32_MAX);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*!
+  * @file lock.h
+  * @brief the lock used internally by the csync primitives
+  * @details defining CSYNC_LOCK_MUTEX to 1 switches the internal locks from pthread_mutex_t to csync_mutex_t,
+  * @details which spins briefly before parking and suits the short critical sections of the pool better
+  * @note csync_cond_t always uses a pthread_mutex_t, since pthread_cond_wait requires one
+*/
+
+#pragma once
+
+#ifndef CSYNC_LOCK_MUTEX
+#define CSYNC_LOCK_MUTEX 0
+#endif
+
+#if CSYNC_LOCK_MUTEX
+
+#include "mutex.h"
+
+typedef csync_mutex_t csync_lock_t;
+
+#define csync_lock_init(lock) ((void)csync_mutex_new(lock))
+#define csync_lock_destroy(lock) ((void)(lock))
+#define csync_lock_lock(lock) csync_mutex_lock(lock)
+#define csync_lock_trylock(lock) csync_mutex_trylock(lock)
+#define csync_lock_unlock(lock) csync_mutex_unlock(lock)
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_mutex_t csync_lock_t;
+
+#define csync_lock_init(lock) ((void)pthread_mutex_init(lock, NULL))
+#define csync_lock_destroy(lock) ((void)pthread_mutex_destroy(lock))
+#define csync_lock_lock(lock) ((void)pthread_mutex_lock(lock))
+#define csync_lock_trylock(lock) pthread_mutex_trylock(lock)
+#define csync_lock_unlock(lock) ((void)pthread_mutex_unlock(lock))
+
+#endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+/*!
+  * @file map.h
+  * @brief a concurrent hash map with lock-free lookups
+  * @details is roughly equivalent to Golang's sync.Map, lookups take no lock and only publish the epoch of the reading thread,
+  * @details writers lock one of CSYNC_MAP_STRIPES stripes, and growing the table is spread over later writes
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "futex.h"
+#include "lock.h"
+
+/*!
+  * @brief the number of locks writers are spread over, a power of two
+*/
+#ifndef CSYNC_MAP_STRIPES
+#define CSYNC_MAP_STRIPES 64
+#endif
+
+/*!
+  * @brief the average number of entries per bucket at which the table doubles
+*/
+#ifndef CSYNC_MAP_LOAD
+#define CSYNC_MAP_LOAD 2
+#endif
+
+/*!
+  * @brief the number of buckets every write moves into the new table while the table grows
+*/
+#ifndef CSYNC_MAP_MIGRATE_BATCH
+#define CSYNC_MAP_MIGRATE_BATCH 8
+#endif
+
+/*!
+  * @brief the number of retired allocations a thread collects before it tries to advance the epoch
+*/
+#ifndef CSYNC_MAP_RETIRE_BATCH
+#define CSYNC_MAP_RETIRE_BATCH 64
+#endif
+
+/*!
+  * @brief hashes a key, NULL hashes the key pointer itself
+*/
+typedef uint64_t (*csync_map_hash_fn)(const void *key);
+
+/*!
+  * @brief returns non-zero if two keys are equal, NULL compares the key pointers
+*/
+typedef int (*csync_map_eq_fn)(const void *a, const void *b);
+
+/*!
+  * @brief called by csync_map_range for every entry
+  * @return non-zero to continue, 0 to stop
+*/
+typedef int (*csync_map_range_fn)(const void *key, void *value, void *arg);
+
+/*!
+  * @brief an entry, only its value and next pointer change after it was published
+*/
+typedef struct csync_map_node {
+    const void *key;
+    uint64_t hash;
+    void *_Atomic value;
+    struct csync_map_node *_Atomic next;
+} csync_map_node_t;
+
+/*!
+  * @brief an array of buckets, each the head of a chain of entries
+  * @details while the table grows, next points at the table twice its size, and every bucket that was moved
+  * @details there holds a marker telling readers to look in next instead, so entries are never missing from both
+*/
+typedef struct csync_map_table {
+    size_t mask; /*! @brief the number of buckets minus 1 */
+    struct csync_map_table *_Atomic next; /*! @brief the table entries are being moved to, NULL if not growing */
+    _Atomic size_t migrate_next; /*! @brief the next bucket a writer helping to grow the table moves */
+    _Atomic size_t migrated; /*! @brief the number of buckets moved to next */
+    csync_map_node_t *_Atomic buckets[]; /*! @brief the chains of entries */
+} csync_map_table_t;
+
+/*!
+  * @brief a writer lock, padded to its own cache line
+  * @details stripe s guards every bucket whose index ends with the bits of s, in every table
+*/
+typedef struct csync_map_stripe {
+    _Alignas(CSYNC_CACHE_LINE) csync_lock_t lock;
+    _Atomic size_t count; /*! @brief the number of entries in the buckets of this stripe, only changed with lock held */
+} csync_map_stripe_t;
+
+/*!
+  * @brief the epoch based reclamation state of a thread
+  * @details nodes and tables a thread removed are kept in one of three lists, by the epoch they were removed
+  * @details in, and freed once the global epoch moved two further, when no reader can still see them
+*/
+typedef struct csync_map_thread {
+    _Atomic uint64_t state; /*! @brief the epoch shifted left by one with the lowest bit set while reading the map, 0 otherwise */
+    _Atomic int in_use; /*! @brief whether a thread owns this state, an exited thread's state is adopted by the next new one */
+    unsigned int depth; /*! @brief the number of nested csync_map calls of the owning thread */
+    void **retired[3]; /*! @brief allocations removed from the map, by epoch modulo 3 */
+    size_t count[3]; /*! @brief the number of allocations in every list */
+    size_t size[3]; /*! @brief the capacity of every list */
+    uint64_t epoch[3]; /*! @brief the epoch the allocations in every list were removed in */
+    struct csync_map_thread *next; /*! @brief all thread states of a map, never removed until the map is destroyed */
+} csync_map_thread_t;
+
+/*!
+  * @brief a concurrent hash map from keys to values
+  * @details the map stores the key and value pointers given to it, and never frees what they point to
+  * @note every map consumes one pthread key, so at most PTHREAD_KEYS_MAX maps may exist at once
+*/
+typedef struct csync_map {
+    csync_map_table_t *_Atomic table; /*! @brief the table lookups start at */
+    csync_map_hash_fn hash;
+    csync_map_eq_fn eq;
+    csync_map_stripe_t *stripes; /*! @brief CSYNC_MAP_STRIPES writer locks */
+    csync_lock_t resize; /*! @brief serializes starting and finishing to grow the table */
+    _Atomic uint64_t epoch; /*! @brief the global epoch of the reclamation scheme */
+    csync_map_thread_t *_Atomic threads; /*! @brief the reclamation state of every thread that used the map */
+    pthread_key_t key; /*! @brief used to lookup the calling thread's reclamation state */
+} csync_map_t;
+
+/*!
+  * @brief returns a new empty map
+  * @param hash hashes keys, NULL to use the key pointers themselves, which allows integers cast to pointers as keys
+  * @param eq compares keys, NULL to compare the key pointers
+  * @return Success: an initialized instance of csync_map_t
+  * @return Failure: NULL if memory or a pthread key couldn't be allocated
+*/
+csync_map_t *csync_map_new(csync_map_hash_fn hash, csync_map_eq_fn eq);
+
+/*!
+  * @brief looks up the value stored for key
+  * @details takes no map lock, the only shared write is publishing this thread's epoch for writers to scan
+  * @details the first call on a thread allocates its reclamation state, freeing retired entries is left to writers
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to look up
+  * @param value set to the value if found, may be NULL
+  * @return 1 if the key was found, 0 otherwise
+  * @warning we exit if that state can't be allocated
+*/
+int csync_map_load(csync_map_t *map, const void *key, void **value);
+
+/*!
+  * @brief sets the value stored for key, adding the key if it is missing
+  * @return Success: 0
+  * @return Failure: ENOMEM if the key was missing and memory couldn't be allocated
+*/
+int csync_map_store(csync_map_t *map, const void *key, void *value);
+
+/*!
+  * @brief adds the key with value unless it is already present
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to add
+  * @param value the value to store if the key is missing
+  * @param actual set to the value now stored for key, may be NULL
+  * @return Success: 0 if value was stored
+  * @return Failure: EEXIST if the key was present, ENOMEM if memory couldn't be allocated
+*/
+int csync_map_load_or_store(csync_map_t *map, const void *key, void *value, void **actual);
+
+/*!
+  * @brief removes key from the map
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to remove
+  * @param value set to the value that was stored for key, may be NULL
+  * @return 1 if the key was removed, 0 if it wasn't present
+*/
+int csync_map_delete(csync_map_t *map, const void *key, void **value);
+
+/*!
+  * @brief calls fn for every entry until it returns 0
+  * @details like Go's sync.Map.Range this is not a snapshot, changes made during the call may or may not be seen,
+  * @details but no key is visited twice, and fn may modify the map
+*/
+void csync_map_range(csync_map_t *map, csync_map_range_fn fn, void *arg);
+
+/*!
+  * @brief returns the number of entries
+  * @details the stripes are read one after the other, so the result is only exact if no thread is writing
+*/
+size_t csync_map_len(csync_map_t *map);
+
+/*!
+  * @brief frees the map and all entries, but not the keys and values
+  * @warning do not use while other threads are still using the map
+*/
+void csync_map_destroy(csync_map_t *map);
\ No newline at end of file
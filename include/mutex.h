@@ -0,0 +1,116 @@
+/*!
+  * @file mutex.h
+  * @brief a mutual exclusion lock that spins briefly before parking on a futex
+  * @details is roughly equivalent to Golang's sync.Mutex, including its starvation mode
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*!
+  * @brief the mutex is held
+*/
+#define CSYNC_MUTEX_LOCKED 1
+
+/*!
+  * @brief a waiter was woken or is spinning, so unlocking doesn't need to wake another one
+*/
+#define CSYNC_MUTEX_WOKEN 2
+
+/*!
+  * @brief the mutex is handed directly from the unlocking thread to a waiter
+*/
+#define CSYNC_MUTEX_STARVING 4
+
+/*!
+  * @brief the number of waiters is stored above the flag bits
+*/
+#define CSYNC_MUTEX_WAITER_SHIFT 3
+
+/*!
+  * @brief how long a waiter may fail to get the mutex before it switches it to starvation mode
+*/
+#ifndef CSYNC_MUTEX_STARVATION_NS
+#define CSYNC_MUTEX_STARVATION_NS 1000000
+#endif
+
+/*!
+  * @brief the number of times a thread spins while the holder is running, before it parks
+*/
+#ifndef CSYNC_MUTEX_SPINS
+#define CSYNC_MUTEX_SPINS 4
+#endif
+
+/*!
+  * @brief a mutual exclusion lock, the zero value is an unlocked mutex
+  * @details in normal mode a woken waiter competes with newly arriving threads, which usually win since
+  * @details they are already running, this keeps throughput high for short critical sections
+  * @details a waiter that failed to get the lock for more than CSYNC_MUTEX_STARVATION_NS switches the mutex
+  * @details to starvation mode, in which unlocking hands the mutex straight to a waiter and new threads
+  * @details queue up instead of spinning, until a waiter gets the lock quickly or no waiters are left
+*/
+typedef struct csync_mutex {
+    _Atomic uint32_t state; /*! @brief CSYNC_MUTEX_LOCKED, CSYNC_MUTEX_WOKEN and CSYNC_MUTEX_STARVING, and the number of waiters */
+    _Atomic uint32_t sema; /*! @brief futex word counting the wake ups handed to parked waiters that haven't taken them yet */
+} csync_mutex_t;
+
+/*!
+  * @brief will initialize the given csync_mutex_t instance as unlocked
+  * @param mutex a declared but uninitialized csync_mutex_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_mutex_t
+  * @return Failure (mutex == NULL): NULL
+*/
+csync_mutex_t *csync_mutex_new(csync_mutex_t *mutex);
+
+/*!
+  * @brief the contended part of csync_mutex_lock, spins and parks until the mutex is acquired
+*/
+void csync_mutex_lock_slow(csync_mutex_t *mutex);
+
+/*!
+  * @brief the part of csync_mutex_unlock that wakes or hands the mutex to a waiter
+  * @param state the state right after the locked bit was cleared
+*/
+void csync_mutex_unlock_slow(csync_mutex_t *mutex, uint32_t state);
+
+/*!
+  * @brief locks the mutex, blocking until it is available
+  * @details an uncontended lock is a single compare and swap
+*/
+static inline void csync_mutex_lock(csync_mutex_t *mutex) {
+    uint32_t state = 0;
+    if (atomic_compare_exchange_strong_explicit(&mutex->state, &state, CSYNC_MUTEX_LOCKED, memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    csync_mutex_lock_slow(mutex);
+}
+
+/*!
+  * @brief locks the mutex if that is possible without blocking
+  * @return Success: 0 if the mutex was locked
+  * @return Failure: EBUSY if it is held, or handed to a waiter in starvation mode
+*/
+static inline int csync_mutex_trylock(csync_mutex_t *mutex) {
+    uint32_t state = atomic_load_explicit(&mutex->state, memory_order_relaxed);
+    while ((state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_STARVING)) == 0) {
+        if (atomic_compare_exchange_weak_explicit(&mutex->state, &state, state | CSYNC_MUTEX_LOCKED, memory_order_acquire, memory_order_relaxed)) {
+            return 0;
+        }
+    }
+    return EBUSY;
+}
+
+/*!
+  * @brief unlocks the mutex
+  * @details without waiters this is a single atomic subtraction
+  * @warning unlocking a mutex that isn't locked is considered a runtime error and we will exit
+*/
+static inline void csync_mutex_unlock(csync_mutex_t *mutex) {
+    uint32_t state = atomic_fetch_sub_explicit(&mutex->state, CSYNC_MUTEX_LOCKED, memory_order_release) - CSYNC_MUTEX_LOCKED;
+    if (state != 0) {
+        csync_mutex_unlock_slow(mutex, state);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*!
+  * @file once.h
+  * @brief runs an initializer exactly once, no matter how many threads call it
+  * @details is roughly equivalent to Golang's sync.Once, once initialized a call is a single acquire load
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*!
+  * @brief the initializer hasn't run yet, or it failed
+*/
+#define CSYNC_ONCE_NEW 0
+
+/*!
+  * @brief a thread is running the initializer
+*/
+#define CSYNC_ONCE_RUNNING 1
+
+/*!
+  * @brief a thread is running the initializer and others are parked waiting for it
+*/
+#define CSYNC_ONCE_PARKED 2
+
+/*!
+  * @brief the initializer completed
+*/
+#define CSYNC_ONCE_DONE 3
+
+/*!
+  * @brief statically initializes a csync_once_t, as an alternative to csync_once_new
+*/
+#define CSYNC_ONCE_INIT {CSYNC_ONCE_NEW}
+
+/*!
+  * @brief remembers whether an initializer completed
+*/
+typedef struct csync_once {
+    _Atomic uint32_t state; /*! @brief futex word holding one of CSYNC_ONCE_NEW, CSYNC_ONCE_RUNNING, CSYNC_ONCE_PARKED and CSYNC_ONCE_DONE */
+} csync_once_t;
+
+/*!
+  * @brief will initialize the given csync_once_t instance
+  * @param once a declared but uninitialized csync_once_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_once_t
+  * @return Failure (once == NULL): NULL
+*/
+csync_once_t *csync_once_new(csync_once_t *once);
+
+/*!
+  * @brief the first part of the slow path, decides whether the caller runs the initializer
+  * @details parks on the futex while another thread runs it
+  * @return 1 if the caller has to run the initializer and then call csync_once_leave, 0 if it completed
+*/
+int csync_once_enter(csync_once_t *once);
+
+/*!
+  * @brief publishes the result of an initializer run after csync_once_enter returned 1, waking the parked threads
+  * @param once an initialized instance of csync_once_t
+  * @param done 1 if the initializer completed, 0 to let the next caller try again
+*/
+void csync_once_leave(csync_once_t *once, int done);
+
+/*!
+  * @brief calls fn(arg) unless it was already called through once
+  * @details concurrent callers block until the first one returned from fn, so every caller sees what fn initialized
+  * @warning fn must not call csync_once_do on the same once, it would wait for itself
+*/
+static inline void csync_once_do(csync_once_t *once, void (*fn)(void *arg), void *arg) {
+    if (atomic_load_explicit(&once->state, memory_order_acquire) == CSYNC_ONCE_DONE) {
+        return;
+    }
+    if (csync_once_enter(once)) {
+        fn(arg);
+        csync_once_leave(once, 1);
+    }
+}
+
+/*!
+  * @brief calls fn(arg) until it succeeded once
+  * @details like csync_once_do, but a failed fn doesn't count as done, the next caller, or one of the
+  * @details callers that waited for it, runs fn again
+  * @return Success: 0 if fn succeeded, either now or during an earlier call
+  * @return Failure: the non-zero error fn returned during this call
+  * @warning fn must not call csync_once_try on the same once, it would wait for itself
+*/
+static inline int csync_once_try(csync_once_t *once, int (*fn)(void *arg), void *arg) {
+    if (atomic_load_explicit(&once->state, memory_order_acquire) == CSYNC_ONCE_DONE) {
+        return 0;
+    }
+    if (!csync_once_enter(once)) {
+        return 0;
+    }
+    int rc = fn(arg);
+    csync_once_leave(once, rc == 0);
+    return rc;
+}
\ No newline at end of file
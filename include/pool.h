@@ -2,12 +2,74 @@
   * @file pool.h
   * @brief allows reuse memory allocated objects to reduce overall memory allocations at the expense of increase memory consumption
   * @details it does this by allowing you to store objects when you are done with them
-  * @details it is not suitable for memory constrained environments as it doesnt deallocate
-  * @details the memory allocated for the objects when they arent in use
+  * @details the memory allocated for objects that arent in use is only given back by trimming
+  * @details the pool, either through csync_pool_trim or a background ticker
 */
 
+#pragma once
+
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "event.h"
+#include "lock.h"
+
+#ifndef CSYNC_POOL_LOCAL_SIZE
+/*!
+  * @brief the number of objects a single thread may cache privately for a pool
+  * @details once a thread's cache is full, half of it is spilled into the shared tier
+  * @details and once it is empty, it is refilled with up to half of this from the shared tier
+*/
+#define CSYNC_POOL_LOCAL_SIZE 32
+#endif
 
+#ifndef CSYNC_POOL_SLAB_SIZE
+/*!
+  * @brief the minimum size in bytes of the slabs objects of fixed size pools are carved from
+  * @details slabs are aligned to their (power of two) size
+*/
+#define CSYNC_POOL_SLAB_SIZE (64 * 1024)
+#endif
+
+#ifndef CSYNC_POOL_HUGEPAGE_SIZE
+/*!
+  * @brief the minimum slab size of pools created with CSYNC_POOL_HUGEPAGES
+  * @details matches the size of a transparent huge page on x86_64
+*/
+#define CSYNC_POOL_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+/*!
+  * @brief the maximum number of node chunks a lock-free pool can grow to
+  * @details chunk n holds size * 2^n nodes so this is never the limiting factor
+*/
+#define CSYNC_POOL_MAX_CHUNKS 32
+
+/*!
+  * @brief flags used to select how a pool is implemented
+*/
+typedef enum csync_pool_flags {
+    /*! @brief use a lock-free stack for the shared tier instead of the mutex guarded items array */
+    CSYNC_POOL_LOCKFREE = 1 << 0,
+    /*! @brief back the slabs of fixed size pools with mmap'd arenas of at least CSYNC_POOL_HUGEPAGE_SIZE using huge pages */
+    CSYNC_POOL_HUGEPAGES = 1 << 1,
+} csync_pool_flags_t;
+
+#ifndef CSYNC_POOL_STATS
+/*!
+  * @brief whether the counters reported by csync_pool_stats are maintained
+  * @details define as 0 to compile them out entirely, csync_pool_stats then reports zeros
+*/
+#define CSYNC_POOL_STATS 1
+#endif
+
+#ifndef CSYNC_POOL_DEFAULT_FLAGS
+/*!
+  * @brief the flags used by csync_pool_new, allows selecting the implementation at build time
+*/
+#define CSYNC_POOL_DEFAULT_FLAGS 0
+#endif
 
 /*!
   * @brief used to free up the memory for objects returned by csync_pool_alloc
@@ -19,21 +81,163 @@ typedef void (*csync_pool_free)(void *);
 */
 typedef void *(*csync_pool_alloc)(void);
 
+/*!
+  * @brief event counters of a pool, kept per thread so that updating them doesn't contend
+  * @details a thread's counters are only written by that thread, and are kept by its cache after it exits
+*/
+typedef struct csync_pool_counters {
+    _Atomic uint64_t gets; /*! @brief objects handed out */
+    _Atomic uint64_t puts; /*! @brief objects returned */
+    _Atomic uint64_t misses; /*! @brief objects created, either by alloc_fn or carved out of a slab */
+    _Atomic uint64_t frees; /*! @brief objects given up on, either by trimming or because they couldn't be stored */
+    _Atomic uint64_t lock_wait_ns; /*! @brief time spent waiting for the mutex while another thread held it */
+} csync_pool_counters_t;
+
+/*!
+  * @brief a snapshot of the statistics of a pool returned by csync_pool_stats
+  * @details the counters are read without stopping other threads, so a snapshot taken
+  * @details while the pool is in use may be slightly inconsistent
+*/
+typedef struct csync_pool_stats {
+    uint64_t gets; /*! @brief objects handed out */
+    uint64_t puts; /*! @brief objects returned */
+    uint64_t misses; /*! @brief objects created, either by alloc_fn or carved out of a slab */
+    uint64_t frees; /*! @brief objects given up on, either by trimming or because they couldn't be stored */
+    uint64_t resizes; /*! @brief growths of the shared tier: items array reallocations, node chunks or slabs */
+    uint64_t idle; /*! @brief objects currently stored in the pool, including thread caches, which have no high-water mark */
+    uint64_t shared_idle; /*! @brief objects currently stored in the shared tier */
+    uint64_t shared_peak_idle; /*! @brief the most objects ever stored in the shared tier at once */
+    uint64_t lock_wait_ns; /*! @brief time spent waiting for the mutex while another thread held it, by any path taking it */
+} csync_pool_stats_t;
+
+/*!
+  * @brief header at the start of every slab of a fixed size pool
+  * @details the objects follow the header, starting at the first multiple of the object alignment
+*/
+typedef struct csync_pool_slab {
+    struct csync_pool_slab *next;
+    unsigned int idle; /*! @brief the number of objects in the victim generation, only used while trimming */
+    int mapped; /*! @brief whether the slab is an mmap'd arena instead of being allocated from the heap */
+    struct csync_pool_local *owner; /*! @brief the thread cache that carved the slab, NULL if carved without one */
+} csync_pool_slab_t;
+
+/*!
+  * @brief the slab objects of a fixed size pool are currently carved from, guarded by the pool mutex
+*/
+typedef struct csync_pool_carve {
+    csync_pool_slab_t *slab; /*! @brief the slab being carved, NULL before the first carve or after it was trimmed */
+    char *next; /*! @brief the next never used object of slab */
+    char *end; /*! @brief the end of the objects of slab */
+} csync_pool_carve_t;
+
+/*!
+  * @brief a per-thread cache of objects sitting in front of the shared tier of a pool
+  * @details items and count are only ever touched by the owning thread, so the common
+  * @details get/put path doesn't need to lock the pool
+  * @details the cache is linked into the pool so that it can be cleaned up by csync_pool_destroy
+  * @details in fixed size pools every thread carves its own slabs, and objects put by another
+  * @details thread are pushed onto the remote queue of the cache owning their slab
+  * @details once its thread exits the cache is abandoned rather than freed, since other threads may
+  * @details still push onto its remote queue, and is handed to the next thread starting to use the pool
+*/
+typedef struct csync_pool_local {
+    void *items[CSYNC_POOL_LOCAL_SIZE];
+    unsigned int count;
+    unsigned int epoch; /*! @brief the trim epoch of the pool the cached objects belong to */
+    csync_pool_counters_t stats; /*! @brief the counters of the owning thread */
+    csync_pool_carve_t carve; /*! @brief fixed size mode: the slab owned by this cache that is being carved */
+    void *_Atomic remote; /*! @brief fixed size mode: objects returned by other threads, linked through the objects */
+    void *returned; /*! @brief fixed size mode: objects taken off of remote that didn't fit into items yet */
+    _Atomic int abandoned; /*! @brief whether the owning thread exited, only written while holding the pool mutex */
+    struct csync_pool *pool;
+    struct csync_pool_local *prev;
+    struct csync_pool_local *next;
+} csync_pool_local_t;
+
+/*!
+  * @brief the cache of a thread for the pool with a given id
+*/
+typedef struct csync_pool_slot {
+    csync_pool_local_t *local;
+    uint64_t gen; /*! @brief the gen of the pool local belongs to, a different one means the pool was destroyed */
+} csync_pool_slot_t;
+
+/*!
+  * @brief the caches of a thread for all pools, indexed by pool id
+  * @details every pool shares a single pthread key holding this table, so creating pools doesn't use up keys
+*/
+typedef struct csync_pool_table {
+    unsigned int size;
+    csync_pool_slot_t slots[];
+} csync_pool_table_t;
+
+/*!
+  * @brief a node of the lock-free shared tier holding a single object
+  * @details nodes are never freed before the pool is destroyed, and are referenced by index
+  * @details so that the stack heads can carry a generation counter protecting against ABA
+*/
+typedef struct csync_pool_node {
+    void *item;
+    _Atomic uint32_t next; /*! @brief index + 1 of the next node, 0 terminates the stack */
+} csync_pool_node_t;
+
 /*!
   * @brief a pool of void pointers along with a function to allocate new ones
   * @details it is essentially a pool of reusable objects that reduce memory allocations
   * @details it does this by providing a means of creating new objects if none are available for reuse
   * @details and allowing you to return the object back to the pool when you no longer need it
   * @details subsequent attempst to creating a new object will be skipped as long as there is an object in the pool
+  * @details every thread gets a private cache of up to CSYNC_POOL_LOCAL_SIZE objects, only when
+  * @details that cache is empty or full is the shared tier (items, guarded by mutex) used
+  * @details when a thread exits the objects in its cache are handed back to the shared tier
+  * @details objects of fixed size pools are returned to the thread that carved them, so that
+  * @details a thread getting objects that are put by another doesn't keep carving new ones
+  * @details with CSYNC_POOL_LOCKFREE the shared tier is a Treiber stack of nodes instead, whose head
+  * @details packs a 32 bit generation with the node index so it can be swapped with a single 64 bit CAS
+  * @details pools created by csync_pool_new_fixed carve their objects out of slabs instead of calling alloc_fn
+  * @details and their shared tier is a free list stored inside of the free objects themselves
+  * @details the shared tier is split into the current generation, and a victim generation that
+  * @details holds the objects left over from before the last trim and is freed by the next one
   * @note it is threadsafe as long as all interaction with the pool are done through the functions
 */
 typedef struct csync_pool {
-    void **items;
-    unsigned int count;
-    unsigned int size;
-    pthread_mutex_t mutex;
+    void **items; /*! @brief the shared tier of objects */
+    unsigned int count; /*! @brief the number of objects in the shared tier */
+    unsigned int size; /*! @brief the capacity of the items array, or the number of nodes in the first chunk in lock-free mode */
+    csync_lock_t mutex; /*! @brief guards the shared tier and the list of thread caches */
     csync_pool_alloc alloc_fn;
     csync_pool_free free_fn;
+    unsigned int id; /*! @brief the index of the pool's cache in the table of every thread */
+    uint64_t gen; /*! @brief tells the pool apart from destroyed pools that used the same id */
+    _Atomic unsigned int exiting; /*! @brief exiting threads still flushing their cache into the pool */
+    csync_pool_local_t *locals; /*! @brief all thread caches created for this pool */
+    int flags; /*! @brief the csync_pool_flags_t the pool was created with */
+    _Atomic uint64_t head; /*! @brief lock-free mode: stack of nodes holding objects */
+    _Atomic uint64_t free_nodes; /*! @brief lock-free mode: stack of unused nodes */
+    csync_pool_node_t *_Atomic chunks[CSYNC_POOL_MAX_CHUNKS]; /*! @brief lock-free mode: node storage, grown under mutex */
+    unsigned int nchunks; /*! @brief lock-free mode: the number of allocated chunks */
+    size_t obj_size; /*! @brief fixed size mode: the distance between objects, 0 for pools using alloc_fn */
+    size_t obj_offset; /*! @brief fixed size mode: the offset of the first object in a slab */
+    size_t slab_size; /*! @brief fixed size mode: the size and alignment of slabs */
+    csync_pool_slab_t *slabs; /*! @brief fixed size mode: all slabs, guarded by mutex */
+    csync_pool_slab_t *decommitted; /*! @brief fixed size mode: trimmed arenas kept for reuse, guarded by mutex */
+    csync_pool_carve_t carve; /*! @brief fixed size mode: the slab carved from without a thread cache */
+    void *free_list; /*! @brief fixed size mode: the shared tier, linked through the objects */
+    void **victim; /*! @brief the victim generation of the items array */
+    unsigned int victim_count; /*! @brief the number of objects in the victim array */
+    void *victim_list; /*! @brief fixed size mode: the victim generation of free_list */
+    _Atomic uint64_t victim_head; /*! @brief lock-free mode: the victim generation of head */
+    _Atomic unsigned int epoch; /*! @brief incremented by every trim */
+    pthread_t ticker; /*! @brief the thread started by csync_pool_ticker_start */
+    csync_event_t ticker_stop; /*! @brief set to wake up the ticker when it is stopped */
+    unsigned int ticker_interval; /*! @brief milliseconds between two trims of the ticker */
+    int ticker_running; /*! @brief whether the ticker is running, guarded by mutex */
+    csync_pool_counters_t stats; /*! @brief counters of updates made without a thread cache */
+    uint64_t resizes; /*! @brief the number of times the shared tier grew, guarded by mutex */
+    unsigned int cap; /*! @brief the maximum number of objects in the shared tier, 0 if unlimited */
+    unsigned int local_cap; /*! @brief the maximum number of objects in a thread cache */
+    _Atomic uint64_t shared_idle; /*! @brief the number of objects in the shared tier, never less than the actual number */
+    _Atomic uint64_t shared_peak_idle; /*! @brief the highest value of shared_idle */
 } csync_pool_t;
 
 /*!
@@ -47,11 +251,57 @@ typedef struct csync_pool {
   * @param size this is not a max limit, and will be doubled whenever we have allocated size amount
   * @param alloc_fn a function that when called will return a new chunk of memory
   * @param free_fn a function that is used to free up the objects returned by alloc_fn
+  * @note alloc_fn is never called while holding the mutex, so an expensive constructor doesn't block other threads
+  * @note alloc_fn may be NULL, in which case csync_pool_get returns NULL if no object is stored
 */
 csync_pool_t *csync_pool_new(unsigned int size, csync_pool_alloc alloc_fn, csync_pool_free free_fn);
 
+/*!
+  * @brief intializes a pool like csync_pool_new using the given implementation
+  * @param size the initial number of slots (or nodes in lock-free mode) in the shared tier
+  * @param alloc_fn a function that when called will return a new chunk of memory
+  * @param free_fn a function that is used to free up the objects returned by alloc_fn
+  * @param flags a bitwise or of csync_pool_flags_t values
+  * @note with CSYNC_POOL_LOCKFREE getting and putting objects never blocks on another thread
+  * @note only growing the node storage, which happens at most CSYNC_POOL_MAX_CHUNKS times, takes the mutex
+*/
+csync_pool_t *csync_pool_new_ex(unsigned int size, csync_pool_alloc alloc_fn, csync_pool_free free_fn, int flags);
+
+/*!
+  * @brief limits the number of objects a pool holds on to
+  * @details at most cap objects are stored in the shared tier, and every thread caches at most
+  * @details min(cap, CSYNC_POOL_LOCAL_SIZE) objects, objects put beyond that are passed to free_fn
+  * @param pool an initialized instance of csync_pool_t
+  * @param cap the maximum number of objects in the shared tier, 0 removes the limit
+  * @note has no effect on fixed size pools, whose objects can't be freed on their own
+  * @warning must be called before the pool is used by other threads
+*/
+void csync_pool_set_cap(csync_pool_t *pool, unsigned int cap);
+
+/*!
+  * @brief intializes a pool of fixed size objects carved out of contiguous slabs
+  * @details instead of calling an alloc_fn for every miss, slabs of at least CSYNC_POOL_SLAB_SIZE
+  * @details bytes are allocated and objects are handed out from them in order, and destroying
+  * @details the pool frees whole slabs, so there is no free_fn and objects are never freed on their own
+  * @details objects are not zeroized when reused, and only the memory of never used objects is zeroed
+  * @details while an object is stored in the pool its first sizeof(void *) bytes hold the free list
+  * @details every thread carves its own slabs, and objects put by a different thread than the one
+  * @details that carved them are handed back to that thread through a lock-free queue
+  * @details with CSYNC_POOL_HUGEPAGES slabs are prefaulted arenas mapped with mmap and advised to use
+  * @details transparent huge pages, falling back to the heap if they can't be mapped, and trimming an arena
+  * @details gives its memory back with MADV_DONTNEED while keeping the mapping around to carve from again
+  * @param obj_size the size of the objects, at least sizeof(void *) is used
+  * @param align the alignment of the objects, must be a power of two or 0 for the alignment of max_align_t
+  * @param size the minimum number of objects per slab
+  * @param flags a bitwise or of csync_pool_flags_t values
+  * @return Success: an initialized pool
+  * @return Failure: NULL if memory couldn't be allocated or align isn't a power of two
+*/
+csync_pool_t *csync_pool_new_fixed(size_t obj_size, size_t align, unsigned int size, int flags);
+
 /*!
   * @brief returns an existing object, creating one from scratch if none are currently stored
+  * @details objects are taken from the calling thread's cache first, then from the shared tier
   * @warning after you are done using the object you need to put it back into the pool
 */
 void *csync_pool_get(csync_pool_t *pool);
@@ -61,12 +311,86 @@ void *csync_pool_get(csync_pool_t *pool);
   * @warning do not use the pointer after you have returned it to the pool
   * @param pool an initializedd instance of csync_pool_t
   * @param item the object to put back into the pool
+  * @note objects are put into the calling thread's cache, and only spill into the shared tier once it is full
   * @note it will resize the items array if needed
 */
 void csync_pool_put(csync_pool_t *pool, void *item);
 
+/*!
+  * @brief takes num objects out of the pool at once, creating the ones that are missing
+  * @details the objects are taken from the calling thread's cache, and then from the shared
+  * @details tier locking it at most once, and only after that are new objects created
+  * @param pool an initialized instance of csync_pool_t
+  * @param items an array of at least num elements the objects are stored in
+  * @param num the number of objects to get
+  * @note like csync_pool_get, elements are NULL if an object couldn't be created
+*/
+void csync_pool_get_n(csync_pool_t *pool, void **items, unsigned int num);
+
+/*!
+  * @brief returns num objects back into the pool at once
+  * @details the objects fill up the calling thread's cache first, the remaining ones are
+  * @details stored in the shared tier locking it at most once
+  * @param pool an initialized instance of csync_pool_t
+  * @param items the objects to put back into the pool
+  * @param num the number of objects in items
+  * @warning do not use the pointers after you have returned them to the pool
+  * @note items is used as scratch space, so its contents are undefined afterwards
+*/
+void csync_pool_put_n(csync_pool_t *pool, void **items, unsigned int num);
+
+/*!
+  * @brief creates num objects using nthreads threads and stores them in the pool
+  * @details used to pay for creating objects at startup instead of during the first burst of traffic
+  * @details the objects are stored in the shared tier, and are subject to csync_pool_trim like any other object
+  * @param pool an initialized instance of csync_pool_t
+  * @param num the number of objects to create
+  * @param nthreads the number of threads to create them with, 0 or 1 uses the calling thread
+  * @return the number of objects that were created, less than num if creating an object failed
+*/
+unsigned int csync_pool_prewarm(csync_pool_t *pool, unsigned int num, unsigned int nthreads);
+
+/*!
+  * @brief frees the objects that have been idle since the previous trim
+  * @details objects stored in the shared tier move to a victim generation, which is still used
+  * @details by csync_pool_get but only after the current generation is empty, and whatever
+  * @details is left in the victim generation by the next trim is passed to free_fn
+  * @details fixed size pools instead free every slab whose objects are all in the victim generation
+  * @details threads move the objects in their cache to the shared tier the next time they use the pool after a trim
+  * @note objects cached by threads that don't use the pool anymore are not trimmed
+*/
+void csync_pool_trim(csync_pool_t *pool);
+
+/*!
+  * @brief starts a background thread calling csync_pool_trim every interval_ms milliseconds
+  * @details objects are freed after being idle for between one and two intervals
+  * @param pool an initialized instance of csync_pool_t
+  * @param interval_ms the time between two trims
+  * @return Success: 0
+  * @return Failure: EBUSY if the ticker is already running, or the error returned by pthread_create
+*/
+int csync_pool_ticker_start(csync_pool_t *pool, unsigned int interval_ms);
+
+/*!
+  * @brief stops the background thread started by csync_pool_ticker_start
+  * @details does nothing if the ticker isn't running
+*/
+void csync_pool_ticker_stop(csync_pool_t *pool);
+
+/*!
+  * @brief takes a snapshot of the statistics of a pool
+  * @details the per-thread counters of all threads using the pool are summed up, which takes the mutex
+  * @param pool an initialized instance of csync_pool_t
+  * @param stats the snapshot is stored here
+  * @note reports zeros when built with CSYNC_POOL_STATS set to 0
+*/
+void csync_pool_stats(csync_pool_t *pool, csync_pool_stats_t *stats);
+
 /*!
   * @brief used to completely destroy the pool and all allocated objects
+  * @details this includes the objects still cached by threads that are alive
+  * @details and stops the ticker if it is running
   * @warning do not use while any objects are borrowed from the pool
+  * @warning do not use while other threads are still using the pool
 */
 void csync_pool_destroy(csync_pool_t *pool);
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*!
+  * @file rwmutex.h
+  * @brief a reader/writer lock whose readers don't share a cache line
+  * @details readers announce themselves in a slot of the cpu they run on, so read locks taken on
+  * @details different cpus don't contend at all, while a writer has to look at every slot
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "futex.h"
+#include "mutex.h"
+
+/*!
+  * @brief the number of times a reader checks whether the writer is gone before parking
+*/
+#ifndef CSYNC_RWMUTEX_SPINS
+#define CSYNC_RWMUTEX_SPINS 100
+#endif
+
+/*!
+  * @brief no writer holds or waits for the lock
+*/
+#define CSYNC_RWMUTEX_FREE 0
+
+/*!
+  * @brief a writer holds the lock or waits for the readers to leave
+*/
+#define CSYNC_RWMUTEX_WRITER 1
+
+/*!
+  * @brief like CSYNC_RWMUTEX_WRITER, and readers are parked waiting for the writer to unlock
+*/
+#define CSYNC_RWMUTEX_PARKED 2
+
+/*!
+  * @brief the readers that locked on one cpu, padded to its own cache line
+  * @details a reader that moved to another cpu unlocks on that cpu's slot, so a single slot may be
+  * @details negative, only the sum over all slots is the number of readers
+*/
+typedef struct csync_rwmutex_slot {
+    _Alignas(CSYNC_CACHE_LINE) _Atomic int32_t readers; /*! @brief read locks minus read unlocks on this cpu */
+} csync_rwmutex_slot_t;
+
+/*!
+  * @brief a reader/writer lock that prefers writers
+  * @details a reader increments its slot and then checks for a writer, a writer sets the writer word
+  * @details and then waits for the slots to sum up to 0, so one of the two always sees the other
+  * @details readers arriving while a writer waits back out and wait, so writers can't be starved
+*/
+typedef struct csync_rwmutex {
+    _Atomic uint32_t writer; /*! @brief futex word holding CSYNC_RWMUTEX_FREE, CSYNC_RWMUTEX_WRITER or CSYNC_RWMUTEX_PARKED */
+    _Atomic uint32_t drain; /*! @brief futex word bumped by readers leaving while a writer waits for them */
+    csync_mutex_t writers; /*! @brief lets only a single writer at a time set the writer word */
+    csync_rwmutex_slot_t *slots; /*! @brief one reader slot per cpu */
+    unsigned int nslots; /*! @brief the number of slots */
+} csync_rwmutex_t;
+
+/*!
+  * @brief returns a new unlocked reader/writer lock with a reader slot for every configured cpu
+  * @return Success: an initialized instance of csync_rwmutex_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_rwmutex_t *csync_rwmutex_new(void);
+
+/*!
+  * @brief locks for reading, blocking while a writer holds or waits for the lock
+  * @details without a writer this is an atomic increment of the slot of the current cpu and a load
+*/
+void csync_rwmutex_rlock(csync_rwmutex_t *rw);
+
+/*!
+  * @brief undoes a single csync_rwmutex_rlock call, which may have been made on another cpu
+*/
+void csync_rwmutex_runlock(csync_rwmutex_t *rw);
+
+/*!
+  * @brief locks for writing, blocking until all readers and other writers are gone
+  * @details new readers are held back as soon as this is called
+*/
+void csync_rwmutex_lock(csync_rwmutex_t *rw);
+
+/*!
+  * @brief unlocks a lock held for writing, and wakes the readers that waited for it
+*/
+void csync_rwmutex_unlock(csync_rwmutex_t *rw);
+
+/*!
+  * @brief frees the lock and its reader slots
+  * @warning do not use while the lock is held or other threads are still using it
+*/
+void csync_rwmutex_destroy(csync_rwmutex_t *rw);
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*!
+  * @file select.h
+  * @brief waits for the first of several conditions and wait groups to become ready
+  * @details is roughly equivalent to a Golang select statement, the calling thread adds itself to every source
+  * @details and sleeps on a single futex word, which the first source to fire sets to its index
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "cond.h"
+#include "wait_group.h"
+
+/*!
+  * @brief the number of cases csync_select handles without allocating
+*/
+#ifndef CSYNC_SELECT_STACK_CASES
+#define CSYNC_SELECT_STACK_CASES 16
+#endif
+
+/*!
+  * @brief the kind of source a case waits on
+*/
+typedef enum csync_select_kind {
+    CSYNC_SELECT_COND, /*! @brief ready once pred(arg) returns non-zero, or on any notification if pred is NULL */
+    CSYNC_SELECT_WAIT_GROUP, /*! @brief ready once the count is 0 */
+} csync_select_kind_t;
+
+/*!
+  * @brief one of the sources csync_select waits on, best declared with the initializer macros below
+*/
+typedef struct csync_select_case {
+    csync_select_kind_t kind;
+    csync_cond_t *cond;
+    csync_cond_pred_t pred; /*! @brief called with the internal mutex of cond held, like in csync_cond_wait_until */
+    void *arg;
+    csync_wait_group_t *wg;
+} csync_select_case_t;
+
+/*!
+  * @brief initializes a case that is ready once pred(arg) returns non-zero
+*/
+#define CSYNC_SELECT_COND_CASE(c, p, a) {.kind = CSYNC_SELECT_COND, .cond = (c), .pred = (p), .arg = (a)}
+
+/*!
+  * @brief initializes a case that is ready once the count of the wait group is 0
+*/
+#define CSYNC_SELECT_WAIT_GROUP_CASE(w) {.kind = CSYNC_SELECT_WAIT_GROUP, .wg = (w)}
+
+/*!
+  * @brief waits until one of the cases is ready, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details the cases are checked in a random order, so when several are ready every one of them gets picked
+  * @details eventually, if none is the thread registers on all of them and sleeps until the first one fires
+  * @details like csync_cond_wait_until, the predicate of a notified condition is checked again before
+  * @details returning, and every case is checked one last time once abs passed
+  * @param cases the sources to wait on, a source may appear in several cases
+  * @param num the number of cases
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @param fired set to the index of the case that was ready
+  * @return Success: 0
+  * @return Failure: ETIMEDOUT if no case was ready at abs, EINVAL if num is 0, ENOMEM if memory couldn't be allocated
+  * @warning like csync_wait_group_wait, a wait group may only be reused once every select on it returned
+*/
+int csync_select(const csync_select_case_t *cases, size_t num, const struct timespec *abs, size_t *fired);
+
+/*!
+  * @brief like csync_select, but gives up once ns nanoseconds have passed
+  * @param cases the sources to wait on
+  * @param num the number of cases
+  * @param ns the maximum time to wait for in nanoseconds
+  * @param fired set to the index of the case that was ready
+  * @return Success: 0
+  * @return Failure: ETIMEDOUT if no case was ready in time, EINVAL if num is 0, ENOMEM like csync_select
+*/
+int csync_select_timeout(const csync_select_case_t *cases, size_t num, uint64_t ns, size_t *fired);
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*!
+  * @file sharded_wait_group.h
+  * @brief a wait group for many threads finishing at nearly the same time
+  * @details instead of every done call hitting the one word of csync_wait_group_t, the count is split
+  * @details into per cpu leaves that are refilled from a root word in batches
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "futex.h"
+
+/*!
+  * @brief the maximum number of credits a leaf takes from the root at once
+*/
+#ifndef CSYNC_SHARDED_WAIT_GROUP_BATCH
+#define CSYNC_SHARDED_WAIT_GROUP_BATCH 64
+#endif
+
+/*!
+  * @brief the share of the count held by one cpu, padded to its own cache line
+*/
+typedef struct csync_sharded_wait_group_leaf {
+    _Alignas(CSYNC_CACHE_LINE) _Atomic int lock; /*! @brief spinlock guarding credits */
+    _Atomic uint32_t credits; /*! @brief the part of the count this leaf took from the root and not marked done yet */
+} csync_sharded_wait_group_leaf_t;
+
+/*!
+  * @brief allows waiting on other threads, like csync_wait_group_t, without a single contended counter
+  * @details csync_sharded_wait_group_add puts the count into the root word, and a done call takes a batch
+  * @details of it into the leaf of the cpu it runs on, so most done calls only touch that leaf
+  * @details the root also counts the leaves holding credits, and only the done call that takes the last
+  * @details credit of the last such leaf while nothing is left in the root sees the total reach 0
+  * @details that call alone goes on to wake the waiters, nobody ever sums up the leaves
+  * @details once the root is empty, done calls on cpus without credits take them from other leaves
+  * @warning like csync_wait_group_t, it may only be reused once every wait call of the previous round returned
+*/
+typedef struct csync_sharded_wait_group {
+    _Atomic uint64_t root; /*! @brief count not handed to any leaf in the upper 32 bits, leaves holding credits in the lower */
+    _Atomic uint32_t waiters; /*! @brief the number of threads in csync_sharded_wait_group_wait */
+    _Atomic uint32_t seq; /*! @brief futex word bumped every time the total reaches 0 while there are waiters */
+    csync_sharded_wait_group_leaf_t *leaves; /*! @brief one leaf per cpu */
+    unsigned int nleaves; /*! @brief the number of leaves */
+} csync_sharded_wait_group_t;
+
+/*!
+  * @brief returns a new sharded wait group with a leaf for every configured cpu
+  * @return Success: an initialized instance of csync_sharded_wait_group_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_sharded_wait_group_t *csync_sharded_wait_group_new(void);
+
+/*!
+  * @brief increments the active count by the given number
+  * @details only touches the root word, so adding the whole count up front is cheaper than adding one at a time
+  * @warning if the part of the count held by the root overflows this is considered a runtime error
+  * @warning and we will exit
+  * @warning adding to a count of 0 while another thread is in csync_sharded_wait_group_wait is not allowed
+*/
+void csync_sharded_wait_group_add(csync_sharded_wait_group_t *wg, unsigned int num);
+
+/*!
+  * @brief decreases the active count typically used to signal a thread is done
+  * @details if the active count is 0 and this is called, it is considered
+  * @details a runtime error and we exit
+*/
+void csync_sharded_wait_group_done(csync_sharded_wait_group_t *wg);
+
+/*!
+  * @brief waits until count reaches 0
+  * @details the calling thread sleeps on a futex and is woken by the done call that drops count to 0
+*/
+void csync_sharded_wait_group_wait(csync_sharded_wait_group_t *wg);
+
+/*!
+  * @brief used to return the number of active actors
+  * @details the leaves are read one after the other, so the result is only exact if no thread is adding or marking done
+  * @return number of active actors
+*/
+unsigned int csync_sharded_wait_group_count(csync_sharded_wait_group_t *wg);
+
+/*!
+  * @brief frees the wait group and its leaves
+  * @warning do not use while other threads are still using the wait group
+*/
+void csync_sharded_wait_group_destroy(csync_sharded_wait_group_t *wg);
\ No newline at end of file
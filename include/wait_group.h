@@ -4,15 +4,25 @@
   * @details can be used for things like safe exits, waiting for all pending processes to exit before deallocating memory
 */
 
-#include <pthread.h>
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include "waitlist.h"
 
 /*!
   * @brief allows waiting on other threads/processes
   * @details is roughly equivalent to Golang's sync.WaitGroup type
+  * @details like Go, the count and the number of waiters share a single 64 bit word so that
+  * @details adding and marking done are a single atomic operation each, and the done call that
+  * @details drops the count to 0 sees every waiter that has to be woken up
+  * @warning like Go, a wait group may only be reused once every csync_wait_group_wait call of the previous round returned
 */
 typedef struct csync_wait_group {
-    unsigned int count; /*! @brief the current number of active threads/processes */
-    pthread_rwlock_t mutex; /*! @brief guards access to the count member */
+    _Atomic uint64_t state; /*! @brief the current number of active threads/processes in the upper 32 bits, and waiters, including those in csync_select, in the lower */
+    _Atomic uint32_t sema; /*! @brief futex word counting the wake ups handed to waiters that haven't taken them yet */
+    csync_waitlist_t selects; /*! @brief threads waiting on this and other primitives through csync_select */
 } csync_wait_group_t;
 
 
@@ -34,13 +44,36 @@ csync_wait_group_t *csync_wait_group_new(csync_wait_group_t *wg);
 /*!
   * @brief waits until count reaches 0
   * @details used to wait on different threads/processes
+  * @details the calling thread sleeps on a futex and is woken by the csync_wait_group_done call that drops count to 0
+  * @details returns immediately without any writes if count is already 0
 */
 void csync_wait_group_wait(csync_wait_group_t *wg);
 
+/*!
+  * @brief waits until count reaches 0, or until ns nanoseconds have passed
+  * @details like csync_wait_group_wait, the calling thread sleeps on a futex instead of polling
+  * @param wg an initialized instance of csync_wait_group_t
+  * @param ns the maximum time to wait for in nanoseconds
+  * @return Success: 0 if count reached 0
+  * @return Failure: ETIMEDOUT if count didn't reach 0 in time
+*/
+int csync_wait_group_wait_timeout(csync_wait_group_t *wg, uint64_t ns);
+
+/*!
+  * @brief waits until count reaches 0, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details a waiter that times out unregisters itself, so waiting in a loop with short deadlines doesn't leak waiters
+  * @param wg an initialized instance of csync_wait_group_t
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at
+  * @return Success: 0 if count reached 0
+  * @return Failure: ETIMEDOUT if count didn't reach 0 in time
+*/
+int csync_wait_group_wait_until(csync_wait_group_t *wg, const struct timespec *abs);
+
 /*!
   * @brief increments the active count by the given number
   * @warning if count + num overflows this is considered a runtime error
   * @warning and we will exit
+  * @warning adding to a count of 0 while another thread is in csync_wait_group_wait is not allowed
 */
 void csync_wait_group_add(csync_wait_group_t *wg, unsigned int num);
 
@@ -55,4 +88,19 @@ void csync_wait_group_done(csync_wait_group_t *wg);
   * @brief used to return the number of active actors
   * @return number of active actors
 */
-unsigned int csync_wait_group_count(csync_wait_group_t *wg);
\ No newline at end of file
+unsigned int csync_wait_group_count(csync_wait_group_t *wg);
+
+/*!
+  * @brief adds a csync_select node to the wait group, which counts as a waiter until it is removed again
+  * @return 1 if count is already 0, in which case the node isn't added
+  * @note used by csync_select, which is what should be called instead
+*/
+int csync_wait_group_select_add(csync_wait_group_t *wg, csync_waitlist_node_t *node);
+
+/*!
+  * @brief removes a node added by csync_wait_group_select_add
+  * @details like a timed out waiter, takes the wake up of the final done call if it already reset the count,
+  * @details so that call is done with the wait group before the selecting thread returns
+  * @note used by csync_select, which is what should be called instead
+*/
+void csync_wait_group_select_remove(csync_wait_group_t *wg, csync_waitlist_node_t *node);
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*!
+  * @file waitlist.h
+  * @brief the threads waiting on a primitive through csync_select
+  * @details every csync_cond_t and csync_wait_group_t keeps one, a thread selecting on several of them
+  * @details adds a node to each list and sleeps on a single futex word, which the first primitive to fire sets
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*!
+  * @brief the registration of a selecting thread on one primitive
+*/
+typedef struct csync_waitlist_node {
+    struct csync_waitlist_node *next;
+    struct csync_waitlist_node *prev;
+    struct csync_waitlist *list; /*! @brief the list the node is on */
+    _Atomic uint32_t *fired; /*! @brief futex word of the selecting thread, 0 until the first primitive fires */
+    uint32_t id; /*! @brief the value fired is set to minus 1 */
+} csync_waitlist_node_t;
+
+/*!
+  * @brief a list of selecting threads guarded by a spinlock, as it is only held to link, unlink or fire nodes
+*/
+typedef struct csync_waitlist {
+    _Atomic uint32_t lock;
+    _Atomic uint32_t count; /*! @brief the number of nodes, lets primitives skip the lock when nobody selects */
+    csync_waitlist_node_t *head;
+} csync_waitlist_t;
+
+/*!
+  * @brief initializes an empty list
+*/
+void csync_waitlist_init(csync_waitlist_t *list);
+
+/*!
+  * @brief adds node to list
+  * @details is followed by a seq_cst fence, so after checking its condition a thread either saw the change
+  * @details or the thread that made it sees the node, as long as that one fences before csync_waitlist_waiting
+*/
+void csync_waitlist_add(csync_waitlist_t *list, csync_waitlist_node_t *node);
+
+/*!
+  * @brief removes node from the list it was added to, once this returns it is no longer touched by csync_waitlist_fire
+*/
+void csync_waitlist_remove(csync_waitlist_node_t *node);
+
+/*!
+  * @brief wakes every thread with a node on the list, unless another primitive woke it first
+  * @return the number of threads woken
+*/
+unsigned int csync_waitlist_fire(csync_waitlist_t *list);
+
+/*!
+  * @brief returns whether any thread is on the list, callers must fence after changing the state selected on
+*/
+static inline int csync_waitlist_waiting(csync_waitlist_t *list) {
+    return atomic_load_explicit(&list->count, memory_order_relaxed) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*!
+  * @file bufpool.h
+  * @brief a pool of byte buffers of varying length, grouped into power of two size classes
+  * @details every size class is a csync_pool_t, so buffers are cached per thread like any other pooled object
+*/
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bufpool.h"
+
+/*!
+  * @brief stored in front of every buffer, its size keeps the buffer aligned for any type
+*/
+typedef struct csync_bufpool_header {
+    _Alignas(max_align_t) size_t size; /*! @brief the usable length of the buffer */
+    unsigned int index; /*! @brief the size class of the buffer, or CSYNC_BUFPOOL_OVERSIZE */
+} csync_bufpool_header_t;
+
+/*!
+  * @brief returns log2 of size rounded up to the next power of two
+*/
+static unsigned int csync_bufpool_shift(size_t size) {
+    if (size <= 1) {
+        return 0;
+    }
+    return (unsigned int)(sizeof(unsigned long) * 8) - (unsigned int)__builtin_clzl((unsigned long)(size - 1));
+}
+
+/*!
+  * @brief returns the size class holding buffers of len bytes
+  * @return Success: the index of the class
+  * @return Failure: CSYNC_BUFPOOL_OVERSIZE if len is larger than the largest class
+*/
+static unsigned int csync_bufpool_index(csync_bufpool_t *bufpool, size_t len) {
+    unsigned int shift = csync_bufpool_shift(len);
+    if (shift <= bufpool->min_shift) {
+        return 0;
+    }
+    if (shift - bufpool->min_shift >= bufpool->nclasses) {
+        return CSYNC_BUFPOOL_OVERSIZE;
+    }
+    return shift - bufpool->min_shift;
+}
+
+/*!
+  * @brief intializes a buffer pool with size classes from min_size to max_size
+  * @param min_size the size of the smallest class, rounded up to a power of two
+  * @param max_size the size of the largest class, rounded up to a power of two
+  * @param cap the maximum number of idle buffers every class keeps in its shared tier, 0 for no limit
+  * @return Success: an initialized buffer pool
+  * @return Failure: NULL if memory couldn't be allocated or min_size is larger than max_size
+*/
+csync_bufpool_t *csync_bufpool_new(size_t min_size, size_t max_size, unsigned int cap) {
+    unsigned int min_shift = csync_bufpool_shift(min_size);
+    unsigned int max_shift = csync_bufpool_shift(max_size);
+    // leave room for the header without overflowing size_t
+    if (min_shift > max_shift || max_shift >= sizeof(size_t) * 8 - 1) {
+        return NULL;
+    }
+    csync_bufpool_t *bufpool = calloc(1, sizeof(csync_bufpool_t));
+    if (bufpool == NULL) {
+        return NULL;
+    }
+    bufpool->min_shift = min_shift;
+    bufpool->nclasses = max_shift - min_shift + 1;
+    bufpool->classes = calloc(bufpool->nclasses, sizeof(csync_pool_t *));
+    bufpool->misses = calloc(bufpool->nclasses, sizeof(_Atomic uint64_t));
+    if (bufpool->classes == NULL || bufpool->misses == NULL) {
+        free(bufpool->classes);
+        free(bufpool->misses);
+        free(bufpool);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < bufpool->nclasses; i++) {
+        atomic_init(&bufpool->misses[i], 0);
+        // the pools never create buffers themselves since they can't know their size
+        bufpool->classes[i] = csync_pool_new(1, NULL, free);
+        if (bufpool->classes[i] == NULL) {
+            csync_bufpool_destroy(bufpool);
+            return NULL;
+        }
+        csync_pool_set_cap(bufpool->classes[i], cap);
+    }
+    return bufpool;
+}
+
+/*!
+  * @brief changes the capacity of the size class used for buffers of size bytes
+  * @details see csync_pool_set_cap, larger classes usually want a lower cap
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param size a buffer size, selecting the class like csync_bufpool_get
+  * @param cap the maximum number of idle buffers in the shared tier of the class, 0 for no limit
+  * @warning must be called before the buffer pool is used by other threads
+*/
+void csync_bufpool_set_cap(csync_bufpool_t *bufpool, size_t size, unsigned int cap) {
+    unsigned int index = csync_bufpool_index(bufpool, size);
+    if (index != CSYNC_BUFPOOL_OVERSIZE) {
+        csync_pool_set_cap(bufpool->classes[index], cap);
+    }
+}
+
+/*!
+  * @brief returns a buffer of at least min_len bytes
+  * @details the buffer comes from the smallest class holding min_len bytes, and lengths
+  * @details beyond the largest class are allocated directly instead of being pooled
+  * @details like objects of csync_pool_t, reused buffers are not zeroed
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param min_len the number of bytes needed
+  * @return Success: a buffer aligned for any type, use csync_bufpool_size for its actual length
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+void *csync_bufpool_get(csync_bufpool_t *bufpool, size_t min_len) {
+    unsigned int index = csync_bufpool_index(bufpool, min_len);
+    csync_bufpool_header_t *header = NULL;
+    size_t size = min_len;
+    if (index != CSYNC_BUFPOOL_OVERSIZE) {
+        header = csync_pool_get(bufpool->classes[index]);
+        size = (size_t)1 << (bufpool->min_shift + index);
+    } else if (min_len > SIZE_MAX - sizeof(csync_bufpool_header_t)) {
+        return NULL;
+    }
+    if (header == NULL) {
+        header = malloc(sizeof(csync_bufpool_header_t) + size);
+        if (header == NULL) {
+            return NULL;
+        }
+#if CSYNC_POOL_STATS
+        if (index != CSYNC_BUFPOOL_OVERSIZE) {
+            atomic_fetch_add_explicit(&bufpool->misses[index], 1, memory_order_relaxed);
+        }
+#endif
+        header->size = size;
+        header->index = index;
+    }
+    return header + 1;
+}
+
+/*!
+  * @brief returns a buffer back into the pool of its size class
+  * @param bufpool the instance of csync_bufpool_t the buffer was taken from
+  * @param buf a buffer returned by csync_bufpool_get, NULL is ignored
+  * @warning do not use the buffer after you have returned it to the pool
+*/
+void csync_bufpool_put(csync_bufpool_t *bufpool, void *buf) {
+    if (buf == NULL) {
+        return;
+    }
+    csync_bufpool_header_t *header = (csync_bufpool_header_t *)buf - 1;
+    if (header->index == CSYNC_BUFPOOL_OVERSIZE) {
+        free(header);
+        return;
+    }
+    csync_pool_put(bufpool->classes[header->index], header);
+}
+
+/*!
+  * @brief returns the usable length of a buffer returned by csync_bufpool_get
+*/
+size_t csync_bufpool_size(void *buf) {
+    return ((csync_bufpool_header_t *)buf - 1)->size;
+}
+
+/*!
+  * @brief takes a snapshot of the statistics of the size class used for buffers of size bytes
+  * @details the class pools never create buffers, so their misses are counted by the buffer pool and
+  * @details added to both misses and gets of the snapshot of the class, see csync_pool_stats
+  * @param bufpool an initialized instance of csync_bufpool_t
+  * @param size a buffer size, selecting the class like csync_bufpool_get
+  * @param stats the snapshot is stored here, all zeros if size is larger than the largest class
+  * @note reports zeros when built with CSYNC_POOL_STATS set to 0
+*/
+void csync_bufpool_stats(csync_bufpool_t *bufpool, size_t size, csync_pool_stats_t *stats) {
+    unsigned int index = csync_bufpool_index(bufpool, size);
+    if (index == CSYNC_BUFPOOL_OVERSIZE) {
+        memset(stats, 0, sizeof(csync_pool_stats_t));
+        return;
+    }
+    csync_pool_stats(bufpool->classes[index], stats);
+#if CSYNC_POOL_STATS
+    // every miss was handed out without going through the class pool
+    uint64_t misses = atomic_load_explicit(&bufpool->misses[index], memory_order_relaxed);
+    stats->misses += misses;
+    stats->gets += misses;
+#endif
+}
+
+/*!
+  * @brief frees all idle buffers and the pools of the size classes
+  * @warning do not use while any buffers are borrowed from the pool
+  * @warning do not use while other threads are still using the pool
+*/
+void csync_bufpool_destroy(csync_bufpool_t *bufpool) {
+    for (unsigned int i = 0; i < bufpool->nclasses; i++) {
+        if (bufpool->classes[i] != NULL) {
+            csync_pool_destroy(bufpool->classes[i]);
+        }
+    }
+    free(bufpool->classes);
+    free(bufpool->misses);
+    free(bufpool);
+}
\ No newline at end of file
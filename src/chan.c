@@ -0,0 +1,395 @@
+/*!
+  * @file chan.h
+  * @brief a bounded multi producer multi consumer channel of pointers
+  * @details is roughly equivalent to a buffered Golang channel, built on a ring of slots that each carry a sequence
+  * @details number, so senders and receivers only contend on the position counter of their own side, and blocked
+  * @details ones park on an eventcount, which costs the other side nothing as long as nobody is blocked
+*/
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "chan.h"
+
+/*!
+  * @brief returns a new channel that holds up to capacity values
+  * @details capacity is rounded up to a power of two of at least 2, there are no unbuffered channels
+  * @return Success: an initialized instance of csync_chan_t
+  * @return Failure: NULL if capacity is 0 or memory couldn't be allocated
+*/
+csync_chan_t *csync_chan_new(size_t capacity) {
+    if (capacity == 0 || capacity > SIZE_MAX / 4) {
+        return NULL;
+    }
+    // with a single slot a filled slot would look free to the next send
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    csync_chan_t *ch = aligned_alloc(CSYNC_CACHE_LINE, sizeof(csync_chan_t));
+    if (ch == NULL) {
+        return NULL;
+    }
+    ch->slots = calloc(size, sizeof(csync_chan_slot_t));
+    if (ch->slots == NULL) {
+        free(ch);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ch->slots[i].seq, i);
+    }
+    ch->mask = size - 1;
+    ch->spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? CSYNC_CHAN_SPINS : 0;
+    atomic_init(&ch->head, 0);
+    atomic_init(&ch->tail, 0);
+    csync_eventcount_new(&ch->not_full);
+    csync_eventcount_new(&ch->not_empty);
+    atomic_init(&ch->full_woken, 0);
+    atomic_init(&ch->empty_woken, 0);
+    return ch;
+}
+
+/*!
+  * @brief wakes up to num threads waiting on ec
+  * @details a woken thread only runs once the scheduler gets to it, and until it retried, every further wake
+  * @details would only be a wasted system call, so as long as woken is set single wakes are left to it, as it
+  * @details passes them on once it got what it waited for
+  * @warning the caller must have issued a seq_cst fence after publishing what the waiters wait for
+*/
+static void csync_chan_wake(csync_eventcount_t *ec, _Atomic uint32_t *woken, size_t num) {
+    if (atomic_load_explicit(&ec->waiters, memory_order_relaxed) == 0) {
+        return;
+    }
+    if (atomic_exchange_explicit(woken, 1, memory_order_acq_rel) && num == 1) {
+        return;
+    }
+    csync_eventcount_wake(ec, num > INT32_MAX ? INT32_MAX : (int)num);
+}
+
+/*!
+  * @brief called by a waiter that leaves without retrying, passes on a wake that may have been left to it
+*/
+static void csync_chan_pass_wake(csync_eventcount_t *ec, _Atomic uint32_t *woken) {
+    if (atomic_exchange_explicit(woken, 0, memory_order_acq_rel)) {
+        atomic_thread_fence(memory_order_seq_cst);
+        csync_chan_wake(ec, woken, 1);
+    }
+}
+
+/*!
+  * @brief sends as many of values as there are free slots, without blocking
+  * @details the free slots following the send position are claimed with a single compare and swap,
+  * @details none of them can be taken away in between, as only a claim makes a free slot filled
+  * @param sent set to the number of values sent
+  * @return 0 if at least one value was sent, EAGAIN if the channel is full, EPIPE if it is closed
+*/
+static int csync_chan_send_some(csync_chan_t *ch, void *const *values, size_t num, size_t *sent) {
+    size_t head = atomic_load_explicit(&ch->head, memory_order_relaxed);
+    size_t pos;
+    size_t n;
+    for (;;) {
+        if (head & CSYNC_CHAN_CLOSED) {
+            *sent = 0;
+            return EPIPE;
+        }
+        pos = head >> 1;
+        size_t seq = atomic_load_explicit(&ch->slots[pos & ch->mask].seq, memory_order_acquire);
+        if (seq != pos) {
+            if ((intptr_t)(seq - pos) < 0) {
+                // the slot still holds the value sent a lap ago
+                *sent = 0;
+                return EAGAIN;
+            }
+            // another sender claimed the slot
+            head = atomic_load_explicit(&ch->head, memory_order_relaxed);
+            continue;
+        }
+        n = 1;
+        while (n < num && atomic_load_explicit(&ch->slots[(pos + n) & ch->mask].seq, memory_order_acquire) == pos + n) {
+            n++;
+        }
+        // closing sets a bit in head, so no send can succeed after the channel was closed
+        if (atomic_compare_exchange_weak_explicit(&ch->head, &head, head + (n << 1), memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        csync_chan_slot_t *slot = &ch->slots[(pos + i) & ch->mask];
+        slot->value = values[i];
+        atomic_store_explicit(&slot->seq, pos + i + 1, memory_order_release);
+    }
+    // a waiter found its slot empty, or full, before parking, so only the operation that changes what it
+    // saw has to wake it, either this one or the one on the other side, whichever sees the other after the fence
+    atomic_thread_fence(memory_order_seq_cst);
+    if ((intptr_t)(atomic_load_explicit(&ch->tail, memory_order_relaxed) - pos) >= 0) {
+        // receivers caught up with us, so they may have parked on the empty channel
+        csync_chan_wake(&ch->not_empty, &ch->empty_woken, n);
+    }
+    if (atomic_load_explicit(&ch->slots[(pos + n) & ch->mask].seq, memory_order_acquire) == pos + n) {
+        // a slot freed while the channel was full woke a single sender, pass it on to the next
+        csync_chan_wake(&ch->not_full, &ch->full_woken, 1);
+    }
+    *sent = n;
+    return 0;
+}
+
+/*!
+  * @brief receives as many values as there are filled slots, up to num, without blocking
+  * @param received set to the number of values received
+  * @return 0 if at least one value was received, EAGAIN if the channel is empty, EPIPE if it is also closed
+*/
+static int csync_chan_recv_some(csync_chan_t *ch, void **values, size_t num, size_t *received) {
+    size_t tail = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+    size_t n;
+    for (;;) {
+        size_t seq = atomic_load_explicit(&ch->slots[tail & ch->mask].seq, memory_order_acquire);
+        if (seq != tail + 1) {
+            if ((intptr_t)(seq - (tail + 1)) > 0) {
+                // another receiver took the value
+                tail = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+                continue;
+            }
+            // empty, or the sender that claimed the slot hasn't filled it yet, in which case it notifies us once it did
+            size_t head = atomic_load_explicit(&ch->head, memory_order_acquire);
+            size_t now = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+            if (now != tail) {
+                tail = now;
+                continue;
+            }
+            *received = 0;
+            return (head & CSYNC_CHAN_CLOSED) && head >> 1 == tail ? EPIPE : EAGAIN;
+        }
+        n = 1;
+        while (n < num && atomic_load_explicit(&ch->slots[(tail + n) & ch->mask].seq, memory_order_acquire) == tail + n + 1) {
+            n++;
+        }
+        if (atomic_compare_exchange_weak_explicit(&ch->tail, &tail, tail + n, memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        csync_chan_slot_t *slot = &ch->slots[(tail + i) & ch->mask];
+        values[i] = slot->value;
+        atomic_store_explicit(&slot->seq, tail + i + ch->mask + 1, memory_order_release);
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if ((intptr_t)((atomic_load_explicit(&ch->head, memory_order_relaxed) >> 1) - (tail + ch->mask + 1)) >= 0) {
+        // senders caught up with us, so they may have parked on the full channel
+        csync_chan_wake(&ch->not_full, &ch->full_woken, n);
+    }
+    if (atomic_load_explicit(&ch->slots[(tail + n) & ch->mask].seq, memory_order_acquire) == tail + n + 1) {
+        // a value sent while the channel was empty woke a single receiver, pass it on to the next
+        csync_chan_wake(&ch->not_empty, &ch->empty_woken, 1);
+    }
+    *received = n;
+    return 0;
+}
+
+/*!
+  * @brief sends at least one of values, spinning and then parking while the channel is full
+  * @return 0, EPIPE or ETIMEDOUT
+*/
+static int csync_chan_send_wait(csync_chan_t *ch, void *const *values, size_t num, size_t *sent, const struct timespec *abs) {
+    for (unsigned int i = 0;; i++) {
+        int rc = csync_chan_send_some(ch, values, num, sent);
+        if (rc != EAGAIN) {
+            return rc;
+        }
+        if (i < ch->spins) {
+            CSYNC_CPU_RELAX();
+            continue;
+        }
+        uint32_t key = csync_eventcount_prepare_wait(&ch->not_full);
+        // a wake may have been left to a waiter that is gone already, ours must not be held back by it
+        atomic_exchange_explicit(&ch->full_woken, 0, memory_order_acq_rel);
+        rc = csync_chan_send_some(ch, values, num, sent);
+        if (rc == EAGAIN) {
+            rc = csync_eventcount_commit_wait_until(&ch->not_full, key, abs);
+            if (rc == 0) {
+                // whatever was published before a wake was left to us is seen by the retry
+                atomic_exchange_explicit(&ch->full_woken, 0, memory_order_acq_rel);
+                continue;
+            }
+        } else {
+            csync_eventcount_cancel_wait(&ch->not_full);
+        }
+        csync_chan_pass_wake(&ch->not_full, &ch->full_woken);
+        return rc;
+    }
+}
+
+/*!
+  * @brief receives at least one value, spinning and then parking while the channel is empty
+  * @return 0, EPIPE or ETIMEDOUT
+*/
+static int csync_chan_recv_wait(csync_chan_t *ch, void **values, size_t num, size_t *received, const struct timespec *abs) {
+    for (unsigned int i = 0;; i++) {
+        int rc = csync_chan_recv_some(ch, values, num, received);
+        if (rc != EAGAIN) {
+            return rc;
+        }
+        if (i < ch->spins) {
+            CSYNC_CPU_RELAX();
+            continue;
+        }
+        uint32_t key = csync_eventcount_prepare_wait(&ch->not_empty);
+        // a wake may have been left to a waiter that is gone already, ours must not be held back by it
+        atomic_exchange_explicit(&ch->empty_woken, 0, memory_order_acq_rel);
+        rc = csync_chan_recv_some(ch, values, num, received);
+        if (rc == EAGAIN) {
+            rc = csync_eventcount_commit_wait_until(&ch->not_empty, key, abs);
+            if (rc == 0) {
+                // whatever was published before a wake was left to us is seen by the retry
+                atomic_exchange_explicit(&ch->empty_woken, 0, memory_order_acq_rel);
+                continue;
+            }
+        } else {
+            csync_eventcount_cancel_wait(&ch->not_empty);
+        }
+        csync_chan_pass_wake(&ch->not_empty, &ch->empty_woken);
+        return rc;
+    }
+}
+
+/*!
+  * @brief sends value unless the channel is full or closed
+  * @return Success: 0
+  * @return Failure: EAGAIN if the channel is full, EPIPE if it is closed
+*/
+int csync_chan_try_send(csync_chan_t *ch, void *value) {
+    size_t sent;
+    return csync_chan_send_some(ch, &value, 1, &sent);
+}
+
+/*!
+  * @brief receives a value unless the channel is empty
+  * @details values sent before the channel was closed are still received after it
+  * @param ch an initialized instance of csync_chan_t
+  * @param value set to the received value
+  * @return Success: 0
+  * @return Failure: EAGAIN if the channel is empty, EPIPE if it is also closed
+*/
+int csync_chan_try_recv(csync_chan_t *ch, void **value) {
+    size_t received;
+    return csync_chan_recv_some(ch, value, 1, &received);
+}
+
+/*!
+  * @brief sends value, blocking while the channel is full
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is or gets closed
+*/
+int csync_chan_send(csync_chan_t *ch, void *value) {
+    return csync_chan_send_until(ch, value, NULL);
+}
+
+/*!
+  * @brief like csync_chan_send, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ch an initialized instance of csync_chan_t
+  * @param value the value to send
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is or gets closed, ETIMEDOUT if it stayed full
+*/
+int csync_chan_send_until(csync_chan_t *ch, void *value, const struct timespec *abs) {
+    size_t sent;
+    return csync_chan_send_wait(ch, &value, 1, &sent, abs);
+}
+
+/*!
+  * @brief receives a value, blocking while the channel is empty
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is closed and all values sent before were received
+*/
+int csync_chan_recv(csync_chan_t *ch, void **value) {
+    return csync_chan_recv_until(ch, value, NULL);
+}
+
+/*!
+  * @brief like csync_chan_recv, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ch an initialized instance of csync_chan_t
+  * @param value set to the received value
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel is closed and drained, ETIMEDOUT if it stayed empty
+*/
+int csync_chan_recv_until(csync_chan_t *ch, void **value, const struct timespec *abs) {
+    size_t received;
+    return csync_chan_recv_wait(ch, value, 1, &received, abs);
+}
+
+/*!
+  * @brief sends all num values in order, claiming as many slots at once as are free
+  * @details blocks while the channel is full, values of concurrent senders may be interleaved between batches
+  * @return the number of values sent, less than num only if the channel got closed
+*/
+size_t csync_chan_send_batch(csync_chan_t *ch, void *const *values, size_t num) {
+    size_t total = 0;
+    while (total < num) {
+        size_t sent;
+        if (csync_chan_send_wait(ch, values + total, num - total, &sent, NULL) != 0) {
+            break;
+        }
+        total += sent;
+    }
+    return total;
+}
+
+/*!
+  * @brief receives up to num values, claiming as many slots at once as are filled
+  * @details blocks until at least one value is available, then returns what could be taken without blocking
+  * @return the number of values received, 0 only once the channel is closed and drained
+*/
+size_t csync_chan_recv_batch(csync_chan_t *ch, void **values, size_t num) {
+    size_t received = 0;
+    if (num == 0 || csync_chan_recv_wait(ch, values, num, &received, NULL) != 0) {
+        return 0;
+    }
+    return received;
+}
+
+/*!
+  * @brief closes the channel, failing all sends and waking every blocked sender and receiver
+  * @details receivers still get the values that were sent before
+  * @return Success: 0
+  * @return Failure: EPIPE if the channel was already closed
+*/
+int csync_chan_close(csync_chan_t *ch) {
+    if (atomic_fetch_or_explicit(&ch->head, CSYNC_CHAN_CLOSED, memory_order_release) & CSYNC_CHAN_CLOSED) {
+        return EPIPE;
+    }
+    csync_eventcount_notify_all(&ch->not_full);
+    csync_eventcount_notify_all(&ch->not_empty);
+    return 0;
+}
+
+/*!
+  * @brief returns the number of values in the channel, which may be outdated by the time it returns
+*/
+size_t csync_chan_len(csync_chan_t *ch) {
+    size_t tail = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ch->head, memory_order_relaxed) >> 1;
+    // claimed sends count as values, and as the loads aren't atomic together the difference may be out of range
+    if (head <= tail) {
+        return 0;
+    }
+    return head - tail > ch->mask + 1 ? ch->mask + 1 : head - tail;
+}
+
+/*!
+  * @brief returns the number of values the channel can hold
+*/
+size_t csync_chan_cap(csync_chan_t *ch) {
+    return ch->mask + 1;
+}
+
+/*!
+  * @brief frees the channel, but not the values left in it
+  * @warning do not use while other threads are still using the channel
+*/
+void csync_chan_destroy(csync_chan_t *ch) {
+    free(ch->slots);
+    free(ch);
+}
\ No newline at end of file
@@ -1,12 +1,19 @@
 /*!
   * @file cond.h
   * @brief a wrapper around pthread conditions
-  * @todo should we auotmatically determine whether or not to use signal/boradcast? recommended way of using pthread is if more than 1 thread is waiting use broadcast instead of signal and it would be neat if we can automatically delegate to the appropriate function
+  * @details the number of waiting threads is tracked, so notifying without waiters costs a single load
+  * @details and broadcasting to a single waiter is turned into a signal
 */
 
+#include <errno.h>
+#include <limits.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 #include "cond.h"
+#include "waitlist.h"
 
 /*!
   * @brief will initialize the given csync_cond_t instance
@@ -29,26 +36,78 @@ csync_cond_t *csync_cond_new(csync_cond_t *cond) {
         }
     }
     pthread_mutex_init(&cond->mutex, NULL);
-    pthread_cond_init(&cond->cond, NULL);
+    atomic_init(&cond->waiters, 0);
+    csync_waitlist_init(&cond->selects);
+    // timed waits take CLOCK_MONOTONIC deadlines, so changing the wall clock doesn't affect them
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond->cond, &attr);
+    pthread_condattr_destroy(&attr);
     return cond;
 }
 
+/*!
+  * @brief registers the calling thread as a waiter
+  * @details must be called with the mutex held and before the waiter checks its predicate, so a notifier
+  * @details that changed the state before we checked it sees us in its unlocked waiter count
+*/
+static void csync_cond_enter(csync_cond_t *cond) {
+    atomic_fetch_add_explicit(&cond->waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static void csync_cond_leave(csync_cond_t *cond) {
+    atomic_fetch_sub_explicit(&cond->waiters, 1, memory_order_relaxed);
+}
+
+/*!
+  * @brief returns whether any thread may be waiting, without taking the mutex
+*/
+static int csync_cond_has_waiters(csync_cond_t *cond) {
+    // pairs with the fence in csync_cond_enter, either we see the waiter or it sees the state we changed
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&cond->waiters, memory_order_relaxed) != 0 || csync_waitlist_waiting(&cond->selects);
+}
+
+/*!
+  * @brief wakes up to n waiters
+  * @warning the mutex must be held, which keeps the waiter count exact
+*/
+static unsigned int csync_cond_wake(csync_cond_t *cond, unsigned int n) {
+    unsigned int woken = 0;
+    if (csync_waitlist_waiting(&cond->selects)) {
+        woken = csync_waitlist_fire(&cond->selects);
+    }
+    unsigned int waiters = atomic_load_explicit(&cond->waiters, memory_order_relaxed);
+    if (n >= waiters) {
+        if (waiters > 1) {
+            pthread_cond_broadcast(&cond->cond);
+        } else if (waiters == 1) {
+            pthread_cond_signal(&cond->cond);
+        }
+        return woken + waiters;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        pthread_cond_signal(&cond->cond);
+    }
+    return woken + n;
+}
+
 /*!
  * @brief wrapper around pthread_cond_signal that handles locking and unlocking
+ * @details returns right away without taking the mutex if no thread is waiting
 */
 void csync_cond_signal(csync_cond_t *cond) {
-    pthread_mutex_lock(&cond->mutex);
-    pthread_cond_signal(&cond->cond);
-    pthread_mutex_unlock(&cond->mutex);
+    csync_cond_notify_n(cond, 1);
 }
 
 /*!
   * @brief wrapper around pthread_cond_broadcast that handles locking/unlocking
+  * @details wakes every waiter; uses a signal when only one thread is waiting, and returns without taking the mutex when none are
 */
 void csync_cond_broadcast(csync_cond_t *cond) {
-    pthread_mutex_lock(&cond->mutex);
-    pthread_cond_broadcast(&cond->cond);
-    pthread_mutex_unlock(&cond->mutex);
+    csync_cond_notify_n(cond, UINT_MAX);
 }
 
 /*!
@@ -56,6 +115,138 @@ void csync_cond_broadcast(csync_cond_t *cond) {
 */
 void csync_cond_wait(csync_cond_t *cond) {
     pthread_mutex_lock(&cond->mutex);
+    csync_cond_enter(cond);
     pthread_cond_wait(&cond->cond, &cond->mutex);
+    csync_cond_leave(cond);
     pthread_mutex_unlock(&cond->mutex);
+}
+
+/*!
+  * @brief waits until pred(arg) returns non-zero
+  * @details pred is checked under the internal mutex before the first wait and after every wake up,
+  * @details so spurious wake ups are ignored and a change made through csync_cond_locked before we
+  * @details started waiting is never missed
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @warning pred must not call any other csync_cond function on cond
+*/
+void csync_cond_wait_until(csync_cond_t *cond, csync_cond_pred_t pred, void *arg) {
+    pthread_mutex_lock(&cond->mutex);
+    csync_cond_enter(cond);
+    while (!pred(arg)) {
+        pthread_cond_wait(&cond->cond, &cond->mutex);
+    }
+    csync_cond_leave(cond);
+    pthread_mutex_unlock(&cond->mutex);
+}
+
+/*!
+  * @brief waits until pred(arg) returns non-zero, or until ns nanoseconds have passed
+  * @details like csync_cond_wait_until, the time is measured with the CLOCK_MONOTONIC clock
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @param ns the maximum time to wait for in nanoseconds
+  * @return Success: 0 if pred returned non-zero
+  * @return Failure: ETIMEDOUT if pred still returned 0 when the time was up
+*/
+int csync_cond_wait_until_timeout(csync_cond_t *cond, csync_cond_pred_t pred, void *arg, uint64_t ns) {
+    struct timespec abs;
+    clock_gettime(CLOCK_MONOTONIC, &abs);
+    abs.tv_sec += (time_t)(ns / 1000000000);
+    abs.tv_nsec += (long)(ns % 1000000000);
+    if (abs.tv_nsec >= 1000000000) {
+        abs.tv_sec += 1;
+        abs.tv_nsec -= 1000000000;
+    }
+    return csync_cond_wait_until_deadline(cond, pred, arg, &abs);
+}
+
+/*!
+  * @brief waits until pred(arg) returns non-zero, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details pred is checked one last time once abs passed, so a change that raced with the timeout is still reported
+  * @param cond an initialized instance of csync_cond_t
+  * @param pred the condition to wait for, called with the internal mutex held
+  * @param arg passed through to pred
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at
+  * @return Success: 0 if pred returned non-zero
+  * @return Failure: ETIMEDOUT if pred still returned 0 at abs
+*/
+int csync_cond_wait_until_deadline(csync_cond_t *cond, csync_cond_pred_t pred, void *arg, const struct timespec *abs) {
+    int rc = 0;
+    pthread_mutex_lock(&cond->mutex);
+    csync_cond_enter(cond);
+    while (!pred(arg)) {
+        if (pthread_cond_timedwait(&cond->cond, &cond->mutex, abs) == ETIMEDOUT) {
+            rc = pred(arg) ? 0 : ETIMEDOUT;
+            break;
+        }
+    }
+    csync_cond_leave(cond);
+    pthread_mutex_unlock(&cond->mutex);
+    return rc;
+}
+
+/*!
+  * @brief wakes up to n of the waiting threads
+  * @details returns right away without taking the mutex if no thread is waiting, otherwise signals
+  * @details min(n, waiters) times, or broadcasts if that wakes all of them
+  * @details threads that were woken but haven't taken the mutex again yet still count as waiting
+  * @details threads in csync_select are always woken, on top of n, as they only recheck their predicate
+  * @param cond an initialized instance of csync_cond_t
+  * @param n the maximum number of threads to wake
+  * @return the number of threads that were woken
+  * @warning like a predicate wait, the state the waiters check must be changed before notifying
+*/
+unsigned int csync_cond_notify_n(csync_cond_t *cond, unsigned int n) {
+    if (n == 0 || !csync_cond_has_waiters(cond)) {
+        return 0;
+    }
+    pthread_mutex_lock(&cond->mutex);
+    unsigned int woken = csync_cond_wake(cond, n);
+    pthread_mutex_unlock(&cond->mutex);
+    return woken;
+}
+
+/*!
+  * @brief calls fn(arg) with the internal mutex held and wakes as many waiters as it asks for
+  * @details changing the state and notifying under a single lock acquisition means a waiter checking
+  * @details its predicate either sees the change or is already waiting when the notification is sent
+  * @param cond an initialized instance of csync_cond_t
+  * @param fn changes the state, and returns how many waiters to wake
+  * @param arg passed through to fn
+*/
+void csync_cond_locked(csync_cond_t *cond, csync_cond_fn_t fn, void *arg) {
+    pthread_mutex_lock(&cond->mutex);
+    int wake = fn(arg);
+    if (wake != 0) {
+        csync_cond_wake(cond, wake < 0 ? UINT_MAX : (unsigned int)wake);
+    }
+    pthread_mutex_unlock(&cond->mutex);
+}
+
+/*!
+  * @brief adds a csync_select node to the condition, unless pred(arg) already holds
+  * @details the node is added and pred checked under the internal mutex, so a change made through
+  * @details csync_cond_locked either shows up in pred or fires the node
+  * @return 1 if pred(arg) returned non-zero, in which case the node isn't added
+*/
+int csync_cond_select_add(csync_cond_t *cond, csync_waitlist_node_t *node, csync_cond_pred_t pred, void *arg) {
+    pthread_mutex_lock(&cond->mutex);
+    csync_waitlist_add(&cond->selects, node);
+    int ready = pred != NULL && pred(arg);
+    if (ready) {
+        csync_waitlist_remove(node);
+    }
+    pthread_mutex_unlock(&cond->mutex);
+    return ready;
+}
+
+/*!
+  * @brief removes a node added by csync_cond_select_add
+*/
+void csync_cond_select_remove(csync_cond_t *cond, csync_waitlist_node_t *node) {
+    (void)cond;
+    csync_waitlist_remove(node);
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*!
+  * @file errgroup.h
+  * @brief runs a group of tasks on their own threads and collects the first error any of them returns
+  * @details is roughly equivalent to Golang's errgroup.Group together with a cancelled context, the first
+  * @details failing task cancels the group, and waiting returns that error without waiting for the other tasks
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "futex.h"
+#include "errgroup.h"
+
+/*!
+  * @brief what a task thread needs to know, freed by the thread once it started
+*/
+typedef struct csync_errgroup_task {
+    csync_errgroup_t *eg;
+    csync_errgroup_fn_t fn;
+    void *arg;
+} csync_errgroup_task_t;
+
+/*!
+  * @brief returns a new error group without any tasks
+  * @return Success: an initialized instance of csync_errgroup_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_errgroup_t *csync_errgroup_new(void) {
+    csync_errgroup_t *eg = calloc(1, sizeof(csync_errgroup_t));
+    if (eg == NULL) {
+        return NULL;
+    }
+    csync_wait_group_new(&eg->wg);
+    atomic_init(&eg->err, 0);
+    atomic_init(&eg->pending, 0);
+    atomic_init(&eg->event, 0);
+    return eg;
+}
+
+/*!
+  * @brief wakes every thread in csync_errgroup_wait so it checks the group again
+*/
+static void csync_errgroup_signal(csync_errgroup_t *eg) {
+    atomic_fetch_add_explicit(&eg->event, 1, memory_order_release);
+    csync_futex_wake(&eg->event, INT32_MAX);
+}
+
+/*!
+  * @brief cancels the group with err, unless it is already cancelled
+  * @param eg an initialized instance of csync_errgroup_t
+  * @param err the error csync_errgroup_wait returns, 0 is replaced by ECANCELED
+*/
+void csync_errgroup_cancel(csync_errgroup_t *eg, int err) {
+    int expected = 0;
+    if (err == 0) {
+        err = ECANCELED;
+    }
+    // only the first error is kept, and only it has to wake the waiters
+    if (atomic_compare_exchange_strong_explicit(&eg->err, &expected, err, memory_order_release, memory_order_relaxed)) {
+        csync_errgroup_signal(eg);
+    }
+}
+
+/*!
+  * @brief records the result of a task and lets go of the group
+*/
+static void csync_errgroup_finish(csync_errgroup_t *eg, int err) {
+    if (err != 0) {
+        csync_errgroup_cancel(eg, err);
+    }
+    if (atomic_fetch_sub_explicit(&eg->pending, 1, memory_order_acq_rel) == 1) {
+        csync_errgroup_signal(eg);
+    }
+    // must be the last access, csync_errgroup_destroy may free the group as soon as the count reaches 0
+    csync_wait_group_done(&eg->wg);
+}
+
+static void *csync_errgroup_run(void *data) {
+    csync_errgroup_task_t task = *(csync_errgroup_task_t *)data;
+    free(data);
+    csync_errgroup_finish(task.eg, task.fn(task.eg, task.arg));
+    return NULL;
+}
+
+/*!
+  * @brief runs fn(eg, arg) on a new detached thread
+  * @details if fn returns a non-zero error and the group isn't cancelled yet, the error is recorded and the group is cancelled
+  * @param eg an initialized instance of csync_errgroup_t
+  * @param fn the task to run
+  * @param arg passed through to fn
+  * @return Success: 0
+  * @return Failure: ECANCELED if the group is already cancelled, the task isn't started
+  * @return Failure: an error of pthread_create, or ENOMEM, if the thread couldn't be started
+*/
+int csync_errgroup_go(csync_errgroup_t *eg, csync_errgroup_fn_t fn, void *arg) {
+    if (csync_errgroup_cancelled(eg)) {
+        return ECANCELED;
+    }
+    csync_errgroup_task_t *task = malloc(sizeof(csync_errgroup_task_t));
+    if (task == NULL) {
+        return ENOMEM;
+    }
+    task->eg = eg;
+    task->fn = fn;
+    task->arg = arg;
+
+    atomic_fetch_add_explicit(&eg->pending, 1, memory_order_relaxed);
+    csync_wait_group_add(&eg->wg, 1);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int rc = pthread_create(&thread, &attr, csync_errgroup_run, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(task);
+        csync_errgroup_finish(eg, 0);
+        return rc;
+    }
+    return 0;
+}
+
+/*!
+  * @brief waits until all tasks have returned, or until the group is cancelled
+  * @details the calling thread sleeps on a futex, so waiting doesn't take any cpu time away from the tasks
+  * @details tasks may still be running when this returns early with an error
+  * @return Success: 0 if all tasks returned 0
+  * @return Failure: the error the group was cancelled with
+*/
+int csync_errgroup_wait(csync_errgroup_t *eg) {
+    for (;;) {
+        // read the event before checking, so a change made after the check wakes us
+        uint32_t event = atomic_load_explicit(&eg->event, memory_order_acquire);
+        int err = atomic_load_explicit(&eg->err, memory_order_acquire);
+        if (err != 0) {
+            return err;
+        }
+        if (atomic_load_explicit(&eg->pending, memory_order_acquire) == 0) {
+            return 0;
+        }
+        csync_futex_wait(&eg->event, event);
+    }
+}
+
+/*!
+  * @brief waits until every task thread is done with the group and frees it
+  * @details unlike csync_errgroup_wait this doesn't return early, cancel the group first to have the tasks stop
+*/
+void csync_errgroup_destroy(csync_errgroup_t *eg) {
+    csync_wait_group_wait(&eg->wg);
+    free(eg);
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*!
+  * @file event.h
+  * @brief a manual reset event for low latency handoffs between threads
+  * @details unlike csync_cond_t there is no mutex, setting an event nobody sleeps on is a single exchange,
+  * @details and a waiter spins for a while before it parks on a futex, so a handoff between two
+  * @details threads running on their own cpus usually doesn't involve the kernel at all
+*/
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "futex.h"
+#include "event.h"
+
+/*!
+  * @brief will initialize the given csync_event_t instance as unset
+  * @details waiters spin CSYNC_EVENT_SPINS times before parking, or not at all if only a single cpu is online
+  * @param ev a declared but uninitialized csync_event_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_event_t
+  * @return Failure (ev == NULL): NULL
+*/
+csync_event_t *csync_event_new(csync_event_t *ev) {
+    if (ev == NULL) {
+        ev = calloc(1, sizeof(csync_event_t));
+        if (ev == NULL) {
+            return NULL;
+        }
+    }
+    atomic_init(&ev->state, CSYNC_EVENT_UNSET);
+    // with a single cpu the thread that sets the event can't run while we spin
+    ev->spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? CSYNC_EVENT_SPINS : 0;
+    return ev;
+}
+
+/*!
+  * @brief changes how many times waiters check the event before parking
+  * @details spinning longer lowers the latency of handoffs between busy threads at the cost of cpu time, 0 parks right away
+*/
+void csync_event_set_spins(csync_event_t *ev, unsigned int spins) {
+    ev->spins = spins;
+}
+
+/*!
+  * @brief sets the event and wakes every thread waiting for it
+  * @details the futex is only woken if a waiter parked, otherwise this is a single exchange
+*/
+void csync_event_set(csync_event_t *ev) {
+    if (atomic_exchange_explicit(&ev->state, CSYNC_EVENT_SET, memory_order_release) == CSYNC_EVENT_PARKED) {
+        csync_futex_wake(&ev->state, INT32_MAX);
+    }
+}
+
+/*!
+  * @brief resets the event so later waiters block again, does nothing if it isn't set
+  * @warning a parked waiter that didn't get to run between set and reset keeps waiting for the next set
+*/
+void csync_event_reset(csync_event_t *ev) {
+    // a parked state must stay parked, or the next set wouldn't wake the sleepers
+    uint32_t expected = CSYNC_EVENT_SET;
+    atomic_compare_exchange_strong_explicit(&ev->state, &expected, CSYNC_EVENT_UNSET, memory_order_relaxed, memory_order_relaxed);
+}
+
+/*!
+  * @brief returns whether the event is set
+*/
+int csync_event_is_set(csync_event_t *ev) {
+    return atomic_load_explicit(&ev->state, memory_order_acquire) == CSYNC_EVENT_SET;
+}
+
+/*!
+  * @brief waits until the event is set
+  * @details spins with a pause instruction first, and parks on the futex once the spins are used up
+*/
+void csync_event_wait(csync_event_t *ev) {
+    csync_event_wait_until(ev, NULL);
+}
+
+/*!
+  * @brief waits until the event is set, or until the CLOCK_MONOTONIC clock reaches abs
+  * @param ev an initialized instance of csync_event_t
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0 if the event is set
+  * @return Failure: ETIMEDOUT if the event wasn't set in time
+*/
+int csync_event_wait_until(csync_event_t *ev, const struct timespec *abs) {
+    for (unsigned int i = 0; i < ev->spins; i++) {
+        if (atomic_load_explicit(&ev->state, memory_order_acquire) == CSYNC_EVENT_SET) {
+            return 0;
+        }
+        CSYNC_CPU_RELAX();
+    }
+    uint32_t state = atomic_load_explicit(&ev->state, memory_order_acquire);
+    for (;;) {
+        if (state == CSYNC_EVENT_SET) {
+            return 0;
+        }
+        // announce that we are going to sleep, so the next set makes the syscall to wake us
+        if (state == CSYNC_EVENT_UNSET && !atomic_compare_exchange_weak_explicit(&ev->state, &state, CSYNC_EVENT_PARKED, memory_order_acquire, memory_order_acquire)) {
+            continue;
+        }
+        if (csync_futex_wait_until(&ev->state, CSYNC_EVENT_PARKED, abs) == ETIMEDOUT) {
+            // the event may have been set just as we gave up
+            return csync_event_is_set(ev) ? 0 : ETIMEDOUT;
+        }
+        state = atomic_load_explicit(&ev->state, memory_order_acquire);
+    }
+}
\ No newline at end of file
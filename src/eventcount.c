@@ -0,0 +1,93 @@
+/*!
+  * @file eventcount.h
+  * @brief lets threads sleep until a lock-free data structure changes, without locks on the notifying side
+  * @details a consumer that found nothing announces itself with csync_eventcount_prepare_wait, checks the
+  * @details data structure once more, and then either commits to sleeping or cancels, a producer calls
+  * @details csync_eventcount_notify after publishing, which doesn't write anything if no consumer is waiting
+*/
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "futex.h"
+#include "eventcount.h"
+
+/*!
+  * @brief will initialize the given csync_eventcount_t instance
+  * @param ec a declared but uninitialized csync_eventcount_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_eventcount_t
+  * @return Failure (ec == NULL): NULL
+*/
+csync_eventcount_t *csync_eventcount_new(csync_eventcount_t *ec) {
+    if (ec == NULL) {
+        ec = calloc(1, sizeof(csync_eventcount_t));
+        if (ec == NULL) {
+            return NULL;
+        }
+    }
+    atomic_init(&ec->epoch, 0);
+    atomic_init(&ec->waiters, 0);
+    return ec;
+}
+
+/*!
+  * @brief announces that the calling thread is about to wait
+  * @details the caller must check its condition again after this, and then call exactly one of
+  * @details csync_eventcount_cancel_wait if it holds, or csync_eventcount_commit_wait if it doesn't
+  * @return the key to pass to csync_eventcount_commit_wait
+*/
+uint32_t csync_eventcount_prepare_wait(csync_eventcount_t *ec) {
+    atomic_fetch_add_explicit(&ec->waiters, 1, memory_order_relaxed);
+    // either a notifier sees us in waiters, or our second check of the condition sees what it published
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&ec->epoch, memory_order_acquire);
+}
+
+/*!
+  * @brief withdraws a csync_eventcount_prepare_wait call because the condition already holds
+*/
+void csync_eventcount_cancel_wait(csync_eventcount_t *ec) {
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+/*!
+  * @brief sleeps until a notify happens after the csync_eventcount_prepare_wait call that returned key
+  * @details returns right away if a notify already happened in between, so it can't be missed
+  * @param ec an initialized instance of csync_eventcount_t
+  * @param key the value returned by csync_eventcount_prepare_wait
+*/
+void csync_eventcount_commit_wait(csync_eventcount_t *ec, uint32_t key) {
+    csync_eventcount_commit_wait_until(ec, key, NULL);
+}
+
+/*!
+  * @brief like csync_eventcount_commit_wait, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param ec an initialized instance of csync_eventcount_t
+  * @param key the value returned by csync_eventcount_prepare_wait
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0 if notified
+  * @return Failure: ETIMEDOUT if no notify happened in time
+*/
+int csync_eventcount_commit_wait_until(csync_eventcount_t *ec, uint32_t key, const struct timespec *abs) {
+    int rc = 0;
+    while (atomic_load_explicit(&ec->epoch, memory_order_acquire) == key) {
+        if (csync_futex_wait_until(&ec->epoch, key, abs) == ETIMEDOUT) {
+            rc = atomic_load_explicit(&ec->epoch, memory_order_acquire) == key ? ETIMEDOUT : 0;
+            break;
+        }
+    }
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+    return rc;
+}
+
+/*!
+  * @brief starts a new epoch and wakes up to num sleeping waiters
+  * @details the slow path of csync_eventcount_notify and csync_eventcount_notify_all
+*/
+void csync_eventcount_wake(csync_eventcount_t *ec, int num) {
+    // waiters that prepared but haven't slept yet see the new epoch and don't go to sleep at all
+    atomic_fetch_add_explicit(&ec->epoch, 1, memory_order_release);
+    csync_futex_wake(&ec->epoch, num);
+}
\ No newline at end of file
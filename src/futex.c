@@ -0,0 +1,59 @@
+/*!
+  * @file futex.h
+  * @brief thin wrappers around the linux futex syscall used to block threads on a 32 bit word
+  * @details a futex lets a thread sleep until another thread changes a word and wakes it, without
+  * @details a mutex or a condition variable, so the uncontended paths of the primitives built on it
+  * @details are a single atomic operation
+  * @note futexes are only available on linux
+*/
+
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "futex.h"
+
+/*!
+  * @brief blocks the calling thread as long as *addr is equal to expected
+  * @details the comparison and going to sleep happen atomically with respect to csync_futex_wake
+  * @details so a wake issued after changing *addr can't be missed
+  * @param addr the word to wait on, only threads of the same process can wake us
+  * @param expected the value *addr has to have for the thread to block
+  * @return Success: 0 when woken up, which may be spurious so the caller must check its condition again
+  * @return Failure: EAGAIN if *addr didn't hold expected, or EINTR if interrupted by a signal
+*/
+int csync_futex_wait(_Atomic uint32_t *addr, uint32_t expected) {
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/*!
+  * @brief blocks the calling thread as long as *addr is equal to expected, or until a deadline passes
+  * @details like csync_futex_wait, but gives up once the CLOCK_MONOTONIC clock reaches abs
+  * @param addr the word to wait on
+  * @param expected the value *addr has to have for the thread to block
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0 when woken up, which may be spurious so the caller must check its condition again
+  * @return Failure: ETIMEDOUT if abs passed, EAGAIN if *addr didn't hold expected, or EINTR if interrupted by a signal
+*/
+int csync_futex_wait_until(_Atomic uint32_t *addr, uint32_t expected, const struct timespec *abs) {
+    // unlike FUTEX_WAIT, FUTEX_WAIT_BITSET takes an absolute timeout measured against CLOCK_MONOTONIC
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, expected, abs, NULL, FUTEX_BITSET_MATCH_ANY) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/*!
+  * @brief wakes up to num threads blocked in csync_futex_wait or csync_futex_wait_until on addr
+  * @param addr the word the threads are waiting on
+  * @param num the maximum number of threads to wake, INT32_MAX wakes all of them
+  * @return the number of threads that were woken up
+*/
+int csync_futex_wake(_Atomic uint32_t *addr, int num) {
+    long woken = syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, num, NULL, NULL, 0);
+    return woken > 0 ? (int)woken : 0;
+}
\ No newline at end of file
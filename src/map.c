@@ -0,0 +1,596 @@
+/*!
+  * @file map.h
+  * @brief a concurrent hash map with lock-free lookups
+  * @details is roughly equivalent to Golang's sync.Map, lookups take no lock and only publish the epoch of the reading thread,
+  * @details writers lock one of CSYNC_MAP_STRIPES stripes, and growing the table is spread over later writes
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "map.h"
+
+/*!
+  * @brief the initial number of buckets, at least CSYNC_MAP_STRIPES so a bucket never spans two stripes
+*/
+#define CSYNC_MAP_MIN_SIZE (CSYNC_MAP_STRIPES < 64 ? 64 : CSYNC_MAP_STRIPES)
+
+/*!
+  * @brief marks a bucket whose entries were moved to the next table
+*/
+static csync_map_node_t csync_map_moved;
+#define CSYNC_MAP_MOVED (&csync_map_moved)
+
+/*!
+  * @brief mixes the bits of a key pointer, so integer keys spread over all buckets
+*/
+static uint64_t csync_map_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t csync_map_hash(csync_map_t *map, const void *key) {
+    return map->hash != NULL ? map->hash(key) : csync_map_mix((uint64_t)(uintptr_t)key);
+}
+
+static int csync_map_equal(csync_map_t *map, csync_map_node_t *node, const void *key, uint64_t hash) {
+    return node->hash == hash && (map->eq != NULL ? map->eq(node->key, key) : node->key == key);
+}
+
+static csync_map_stripe_t *csync_map_stripe(csync_map_t *map, uint64_t hash) {
+    return &map->stripes[hash & (CSYNC_MAP_STRIPES - 1)];
+}
+
+/*!
+  * @brief returns a new table with size empty buckets
+*/
+static csync_map_table_t *csync_map_table_new(size_t size) {
+    csync_map_table_t *table = malloc(sizeof(csync_map_table_t) + size * sizeof(csync_map_node_t *));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->mask = size - 1;
+    atomic_init(&table->next, NULL);
+    atomic_init(&table->migrate_next, 0);
+    atomic_init(&table->migrated, 0);
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&table->buckets[i], NULL);
+    }
+    return table;
+}
+
+/*!
+  * @brief hands the reclamation state of an exiting thread to the next thread that needs one
+  * @details registered as the destructor of map->key, whatever the thread retired is freed by the adopter
+*/
+static void csync_map_thread_exit(void *data) {
+    csync_map_thread_t *thread = (csync_map_thread_t *)data;
+    atomic_store_explicit(&thread->in_use, 0, memory_order_release);
+}
+
+/*!
+  * @brief returns the calling thread's reclamation state, adopting an abandoned one or creating it on first use
+  * @warning we exit if the state can't be allocated, as the map can't be read safely without one
+*/
+static csync_map_thread_t *csync_map_thread(csync_map_t *map) {
+    csync_map_thread_t *thread = pthread_getspecific(map->key);
+    if (thread != NULL) {
+        return thread;
+    }
+    for (thread = atomic_load_explicit(&map->threads, memory_order_acquire); thread != NULL; thread = thread->next) {
+        int in_use = 0;
+        if (atomic_load_explicit(&thread->in_use, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong_explicit(&thread->in_use, &in_use, 1, memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+    if (thread == NULL) {
+        thread = calloc(1, sizeof(csync_map_thread_t));
+        if (thread == NULL) {
+            // the map cant be read safely without reclamation state
+            exit(1);
+        }
+        atomic_init(&thread->state, 0);
+        atomic_init(&thread->in_use, 1);
+        thread->next = atomic_load_explicit(&map->threads, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&map->threads, &thread->next, thread, memory_order_release, memory_order_relaxed)) {
+        }
+    }
+    if (pthread_setspecific(map->key, thread) != 0) {
+        // the state would be adopted again on every call otherwise
+        exit(1);
+    }
+    return thread;
+}
+
+/*!
+  * @brief frees the allocations of a list that were retired at least two epochs before epoch
+*/
+static void csync_map_collect(csync_map_thread_t *thread, unsigned int list, uint64_t epoch) {
+    if (thread->count[list] == 0 || thread->epoch[list] + 2 > epoch) {
+        return;
+    }
+    for (size_t i = 0; i < thread->count[list]; i++) {
+        free(thread->retired[list][i]);
+    }
+    thread->count[list] = 0;
+}
+
+/*!
+  * @brief marks the calling thread as reading the map, so nothing it can reach is freed until csync_map_leave
+  * @details calls nest, only the outermost one announces the epoch, freeing is left to csync_map_retire
+*/
+static csync_map_thread_t *csync_map_enter(csync_map_t *map) {
+    csync_map_thread_t *thread = csync_map_thread(map);
+    if (thread->depth++ > 0) {
+        return thread;
+    }
+    // announcing an epoch that is already stale is harmless, it only holds the next advance back
+    // acquire pairs with csync_map_advance, whoever moved the epoch saw every reader that may still need what we free
+    uint64_t epoch = atomic_load_explicit(&map->epoch, memory_order_acquire);
+    // release so a writer that sees this announcement also sees the end of our previous call
+    atomic_store_explicit(&thread->state, epoch << 1 | 1, memory_order_release);
+    // the announcement must be visible before we load any pointer out of the map
+    atomic_thread_fence(memory_order_seq_cst);
+    return thread;
+}
+
+static void csync_map_leave(csync_map_thread_t *thread) {
+    if (--thread->depth == 0) {
+        atomic_store_explicit(&thread->state, 0, memory_order_release);
+    }
+}
+
+/*!
+  * @brief moves the global epoch forward if every thread reading the map has announced it
+*/
+static void csync_map_advance(csync_map_t *map) {
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t epoch = atomic_load_explicit(&map->epoch, memory_order_relaxed);
+    for (csync_map_thread_t *thread = atomic_load_explicit(&map->threads, memory_order_acquire); thread != NULL; thread = thread->next) {
+        uint64_t state = atomic_load_explicit(&thread->state, memory_order_acquire);
+        if ((state & 1) && state >> 1 != epoch) {
+            return;
+        }
+    }
+    atomic_compare_exchange_strong_explicit(&map->epoch, &epoch, epoch + 1, memory_order_acq_rel, memory_order_relaxed);
+}
+
+/*!
+  * @brief frees ptr once no thread can reach it anymore
+  * @details ptr must already be unreachable for threads entering the map from now on, it is tagged with
+  * @details the global epoch read after that, which every reader that might still see it has announced or
+  * @details lags behind, so the epoch can't move two further before all of them left
+  * @warning we exit if the retired list can't grow, as ptr could neither be freed nor kept safely
+*/
+static void csync_map_retire(csync_map_t *map, csync_map_thread_t *thread, void *ptr) {
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t epoch = atomic_load_explicit(&map->epoch, memory_order_acquire);
+    // only writers retire, so collecting here keeps free() out of lookups
+    for (unsigned int i = 0; i < 3; i++) {
+        csync_map_collect(thread, i, epoch);
+    }
+    unsigned int list = epoch % 3;
+    if (thread->epoch[list] != epoch) {
+        // anything still in this list was retired three or more epochs ago, and was just freed
+        thread->epoch[list] = epoch;
+    }
+    if (thread->count[list] == thread->size[list]) {
+        size_t size = thread->size[list] ? thread->size[list] * 2 : CSYNC_MAP_RETIRE_BATCH;
+        void **retired = realloc(thread->retired[list], size * sizeof(void *));
+        if (retired == NULL) {
+            // the node can neither be freed nor kept
+            exit(1);
+        }
+        thread->retired[list] = retired;
+        thread->size[list] = size;
+    }
+    thread->retired[list][thread->count[list]++] = ptr;
+    if (thread->count[list] % CSYNC_MAP_RETIRE_BATCH == 0) {
+        csync_map_advance(map);
+    }
+}
+
+/*!
+  * @brief returns a new empty map
+  * @param hash hashes keys, NULL to use the key pointers themselves, which allows integers cast to pointers as keys
+  * @param eq compares keys, NULL to compare the key pointers
+  * @return Success: an initialized instance of csync_map_t
+  * @return Failure: NULL if memory or a pthread key couldn't be allocated
+*/
+csync_map_t *csync_map_new(csync_map_hash_fn hash, csync_map_eq_fn eq) {
+    csync_map_t *map = calloc(1, sizeof(csync_map_t));
+    if (map == NULL) {
+        return NULL;
+    }
+    map->stripes = aligned_alloc(CSYNC_CACHE_LINE, CSYNC_MAP_STRIPES * sizeof(csync_map_stripe_t));
+    csync_map_table_t *table = csync_map_table_new(CSYNC_MAP_MIN_SIZE);
+    if (map->stripes == NULL || table == NULL || pthread_key_create(&map->key, csync_map_thread_exit) != 0) {
+        free(table);
+        free(map->stripes);
+        free(map);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < CSYNC_MAP_STRIPES; i++) {
+        csync_lock_init(&map->stripes[i].lock);
+        atomic_init(&map->stripes[i].count, 0);
+    }
+    atomic_init(&map->table, table);
+    map->hash = hash;
+    map->eq = eq;
+    csync_lock_init(&map->resize);
+    atomic_init(&map->epoch, 1);
+    atomic_init(&map->threads, NULL);
+    return map;
+}
+
+/*!
+  * @brief returns the entry of key, following moved buckets into the tables they were moved to
+  * @warning must be called between csync_map_enter and csync_map_leave
+*/
+static csync_map_node_t *csync_map_find(csync_map_t *map, csync_map_table_t *table, const void *key, uint64_t hash) {
+    for (;;) {
+        csync_map_node_t *node = atomic_load_explicit(&table->buckets[hash & table->mask], memory_order_acquire);
+        if (node == CSYNC_MAP_MOVED) {
+            table = atomic_load_explicit(&table->next, memory_order_acquire);
+            continue;
+        }
+        for (; node != NULL; node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+            if (csync_map_equal(map, node, key, hash)) {
+                return node;
+            }
+        }
+        return NULL;
+    }
+}
+
+/*!
+  * @brief looks up the value stored for key
+  * @details takes no map lock, the only shared write is publishing this thread's epoch for writers to scan
+  * @details the first call on a thread allocates its reclamation state, freeing retired entries is left to writers
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to look up
+  * @param value set to the value if found, may be NULL
+  * @return 1 if the key was found, 0 otherwise
+  * @warning we exit if that state can't be allocated
+*/
+int csync_map_load(csync_map_t *map, const void *key, void **value) {
+    uint64_t hash = csync_map_hash(map, key);
+    csync_map_thread_t *thread = csync_map_enter(map);
+    csync_map_node_t *node = csync_map_find(map, atomic_load_explicit(&map->table, memory_order_acquire), key, hash);
+    if (node != NULL && value != NULL) {
+        *value = atomic_load_explicit(&node->value, memory_order_acquire);
+    }
+    csync_map_leave(thread);
+    return node != NULL;
+}
+
+/*!
+  * @brief makes the table entries are moved to the current one, and retires the table it replaces
+  * @details called by whoever moved the last bucket, the resize lock keeps a new resize from starting in between
+*/
+static void csync_map_finish_resize(csync_map_t *map, csync_map_thread_t *thread, csync_map_table_t *table) {
+    csync_lock_lock(&map->resize);
+    atomic_store_explicit(&map->table, atomic_load_explicit(&table->next, memory_order_relaxed), memory_order_release);
+    csync_lock_unlock(&map->resize);
+    csync_map_retire(map, thread, table);
+}
+
+/*!
+  * @brief moves a bucket into the next table
+  * @details the entries are copied rather than relinked, as readers may still walk the old chain, and once
+  * @details the copies are published the bucket is marked moved, so readers always find one of both
+  * @warning must be called with the stripe of the bucket locked
+  * @warning we exit if the copies can't be allocated, as the resize could never complete
+*/
+static void csync_map_migrate(csync_map_t *map, csync_map_thread_t *thread, csync_map_table_t *table, size_t i) {
+    csync_map_table_t *next = atomic_load_explicit(&table->next, memory_order_acquire);
+    csync_map_node_t *head = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+    for (csync_map_node_t *node = head; node != NULL; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        csync_map_node_t *copy = malloc(sizeof(csync_map_node_t));
+        if (copy == NULL) {
+            // a bucket that cant be moved would keep the resize from ever completing
+            exit(1);
+        }
+        copy->key = node->key;
+        copy->hash = node->hash;
+        atomic_init(&copy->value, atomic_load_explicit(&node->value, memory_order_relaxed));
+        // the bucket only ever receives entries from this bucket, and is guarded by the same stripe
+        csync_map_node_t *_Atomic *bucket = &next->buckets[node->hash & next->mask];
+        atomic_init(&copy->next, atomic_load_explicit(bucket, memory_order_relaxed));
+        atomic_store_explicit(bucket, copy, memory_order_release);
+    }
+    atomic_store_explicit(&table->buckets[i], CSYNC_MAP_MOVED, memory_order_release);
+    while (head != NULL) {
+        csync_map_node_t *node = head;
+        head = atomic_load_explicit(&node->next, memory_order_relaxed);
+        csync_map_retire(map, thread, node);
+    }
+    if (atomic_fetch_add_explicit(&table->migrated, 1, memory_order_acq_rel) == table->mask) {
+        csync_map_finish_resize(map, thread, table);
+    }
+}
+
+/*!
+  * @brief returns the table writes to the bucket of hash go to, moving the bucket first if the table grows
+  * @warning must be called with the stripe of hash locked
+*/
+static csync_map_table_t *csync_map_writable(csync_map_t *map, csync_map_thread_t *thread, uint64_t hash) {
+    csync_map_table_t *table = atomic_load_explicit(&map->table, memory_order_acquire);
+    for (;;) {
+        size_t i = hash & table->mask;
+        // a bucket is only marked moved with its stripe locked, so this can't change under us
+        if (atomic_load_explicit(&table->buckets[i], memory_order_relaxed) == CSYNC_MAP_MOVED) {
+            table = atomic_load_explicit(&table->next, memory_order_acquire);
+            continue;
+        }
+        csync_map_table_t *next = atomic_load_explicit(&table->next, memory_order_acquire);
+        if (next == NULL) {
+            return table;
+        }
+        csync_map_migrate(map, thread, table, i);
+        table = next;
+    }
+}
+
+/*!
+  * @brief starts to grow the table to twice its size, unless it is already growing
+  * @details only allocates the new table, the buckets are moved by the writes that follow
+*/
+static void csync_map_start_resize(csync_map_t *map) {
+    csync_lock_lock(&map->resize);
+    csync_map_table_t *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    if (atomic_load_explicit(&table->next, memory_order_relaxed) == NULL) {
+        // if this fails the table keeps its size, and the next insert tries again
+        csync_map_table_t *next = csync_map_table_new((table->mask + 1) * 2);
+        if (next != NULL) {
+            atomic_store_explicit(&table->next, next, memory_order_release);
+        }
+    }
+    csync_lock_unlock(&map->resize);
+}
+
+/*!
+  * @brief moves up to CSYNC_MAP_MIGRATE_BATCH buckets if the table grows
+  * @details is called after every write, so the cost of growing is spread over them and no write stops the world
+*/
+static void csync_map_help_resize(csync_map_t *map, csync_map_thread_t *thread) {
+    csync_map_table_t *table = atomic_load_explicit(&map->table, memory_order_acquire);
+    if (atomic_load_explicit(&table->next, memory_order_acquire) == NULL) {
+        return;
+    }
+    for (unsigned int n = 0; n < CSYNC_MAP_MIGRATE_BATCH; n++) {
+        size_t i = atomic_fetch_add_explicit(&table->migrate_next, 1, memory_order_relaxed);
+        if (i > table->mask) {
+            return;
+        }
+        csync_map_stripe_t *stripe = csync_map_stripe(map, i);
+        csync_lock_lock(&stripe->lock);
+        // writers move the buckets they write to themselves
+        if (atomic_load_explicit(&table->buckets[i], memory_order_relaxed) != CSYNC_MAP_MOVED) {
+            csync_map_migrate(map, thread, table, i);
+        }
+        csync_lock_unlock(&stripe->lock);
+    }
+}
+
+/*!
+  * @brief stores value for key, replacing the value of a present key if replace is set
+  * @return 0 if value was stored, EEXIST if the key was present and replace unset, ENOMEM
+*/
+static int csync_map_put(csync_map_t *map, const void *key, void *value, int replace, void **actual) {
+    uint64_t hash = csync_map_hash(map, key);
+    csync_map_stripe_t *stripe = csync_map_stripe(map, hash);
+    csync_map_thread_t *thread = csync_map_enter(map);
+    csync_lock_lock(&stripe->lock);
+
+    csync_map_table_t *table = csync_map_writable(map, thread, hash);
+    csync_map_node_t *_Atomic *bucket = &table->buckets[hash & table->mask];
+    csync_map_node_t *head = atomic_load_explicit(bucket, memory_order_relaxed);
+    for (csync_map_node_t *node = head; node != NULL; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        if (!csync_map_equal(map, node, key, hash)) {
+            continue;
+        }
+        if (replace) {
+            atomic_store_explicit(&node->value, value, memory_order_release);
+        } else {
+            value = atomic_load_explicit(&node->value, memory_order_relaxed);
+        }
+        csync_lock_unlock(&stripe->lock);
+        csync_map_leave(thread);
+        if (actual != NULL) {
+            *actual = value;
+        }
+        return replace ? 0 : EEXIST;
+    }
+
+    csync_map_node_t *node = malloc(sizeof(csync_map_node_t));
+    if (node == NULL) {
+        csync_lock_unlock(&stripe->lock);
+        csync_map_leave(thread);
+        return ENOMEM;
+    }
+    node->key = key;
+    node->hash = hash;
+    atomic_init(&node->value, value);
+    atomic_init(&node->next, head);
+    atomic_store_explicit(bucket, node, memory_order_release);
+    // every stripe covers the same share of the buckets, so one stripe stands in for the whole table
+    size_t count = atomic_load_explicit(&stripe->count, memory_order_relaxed) + 1;
+    atomic_store_explicit(&stripe->count, count, memory_order_relaxed);
+    int grow = count > (table->mask + 1) / CSYNC_MAP_STRIPES * CSYNC_MAP_LOAD;
+    csync_lock_unlock(&stripe->lock);
+
+    if (grow) {
+        csync_map_start_resize(map);
+    }
+    csync_map_help_resize(map, thread);
+    csync_map_leave(thread);
+    if (actual != NULL) {
+        *actual = value;
+    }
+    return 0;
+}
+
+/*!
+  * @brief sets the value stored for key, adding the key if it is missing
+  * @return Success: 0
+  * @return Failure: ENOMEM if the key was missing and memory couldn't be allocated
+*/
+int csync_map_store(csync_map_t *map, const void *key, void *value) {
+    return csync_map_put(map, key, value, 1, NULL);
+}
+
+/*!
+  * @brief adds the key with value unless it is already present
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to add
+  * @param value the value to store if the key is missing
+  * @param actual set to the value now stored for key, may be NULL
+  * @return Success: 0 if value was stored
+  * @return Failure: EEXIST if the key was present, ENOMEM if memory couldn't be allocated
+*/
+int csync_map_load_or_store(csync_map_t *map, const void *key, void *value, void **actual) {
+    return csync_map_put(map, key, value, 0, actual);
+}
+
+/*!
+  * @brief removes key from the map
+  * @param map an initialized instance of csync_map_t
+  * @param key the key to remove
+  * @param value set to the value that was stored for key, may be NULL
+  * @return 1 if the key was removed, 0 if it wasn't present
+*/
+int csync_map_delete(csync_map_t *map, const void *key, void **value) {
+    uint64_t hash = csync_map_hash(map, key);
+    csync_map_stripe_t *stripe = csync_map_stripe(map, hash);
+    csync_map_thread_t *thread = csync_map_enter(map);
+    csync_lock_lock(&stripe->lock);
+
+    csync_map_table_t *table = csync_map_writable(map, thread, hash);
+    csync_map_node_t *_Atomic *link = &table->buckets[hash & table->mask];
+    csync_map_node_t *node = atomic_load_explicit(link, memory_order_relaxed);
+    while (node != NULL && !csync_map_equal(map, node, key, hash)) {
+        link = &node->next;
+        node = atomic_load_explicit(link, memory_order_relaxed);
+    }
+    if (node == NULL) {
+        csync_lock_unlock(&stripe->lock);
+        csync_map_leave(thread);
+        return 0;
+    }
+    // node->next is left intact for readers that are still standing on node
+    atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed), memory_order_release);
+    atomic_store_explicit(&stripe->count, atomic_load_explicit(&stripe->count, memory_order_relaxed) - 1, memory_order_relaxed);
+    if (value != NULL) {
+        *value = atomic_load_explicit(&node->value, memory_order_relaxed);
+    }
+    csync_lock_unlock(&stripe->lock);
+
+    csync_map_retire(map, thread, node);
+    csync_map_help_resize(map, thread);
+    csync_map_leave(thread);
+    return 1;
+}
+
+/*!
+  * @brief calls fn for every entry of a bucket, or of the two buckets it was split into
+  * @return 0 if fn asked to stop, 1 otherwise
+*/
+static int csync_map_range_bucket(csync_map_table_t *table, size_t i, csync_map_range_fn fn, void *arg) {
+    csync_map_node_t *node = atomic_load_explicit(&table->buckets[i], memory_order_acquire);
+    if (node == CSYNC_MAP_MOVED) {
+        csync_map_table_t *next = atomic_load_explicit(&table->next, memory_order_acquire);
+        return csync_map_range_bucket(next, i, fn, arg) && csync_map_range_bucket(next, i + table->mask + 1, fn, arg);
+    }
+    for (; node != NULL; node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+        if (!fn(node->key, atomic_load_explicit(&node->value, memory_order_acquire), arg)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*!
+  * @brief calls fn for every entry until it returns 0
+  * @details like Go's sync.Map.Range this is not a snapshot, changes made during the call may or may not be seen,
+  * @details but no key is visited twice, and fn may modify the map
+*/
+void csync_map_range(csync_map_t *map, csync_map_range_fn fn, void *arg) {
+    csync_map_thread_t *thread = csync_map_enter(map);
+    csync_map_table_t *table = atomic_load_explicit(&map->table, memory_order_acquire);
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (!csync_map_range_bucket(table, i, fn, arg)) {
+            break;
+        }
+    }
+    csync_map_leave(thread);
+}
+
+/*!
+  * @brief returns the number of entries
+  * @details the stripes are read one after the other, so the result is only exact if no thread is writing
+*/
+size_t csync_map_len(csync_map_t *map) {
+    size_t len = 0;
+    for (unsigned int i = 0; i < CSYNC_MAP_STRIPES; i++) {
+        len += atomic_load_explicit(&map->stripes[i].count, memory_order_relaxed);
+    }
+    return len;
+}
+
+/*!
+  * @brief frees a table, the entries of its buckets that weren't moved, and the tables they were moved to
+*/
+static void csync_map_table_free(csync_map_table_t *table) {
+    csync_map_table_t *next = atomic_load_explicit(&table->next, memory_order_relaxed);
+    for (size_t i = 0; i <= table->mask; i++) {
+        csync_map_node_t *node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+        if (node == CSYNC_MAP_MOVED) {
+            continue;
+        }
+        while (node != NULL) {
+            csync_map_node_t *free_node = node;
+            node = atomic_load_explicit(&node->next, memory_order_relaxed);
+            free(free_node);
+        }
+    }
+    free(table);
+    if (next != NULL) {
+        csync_map_table_free(next);
+    }
+}
+
+/*!
+  * @brief frees the map and all entries, but not the keys and values
+  * @warning do not use while other threads are still using the map
+*/
+void csync_map_destroy(csync_map_t *map) {
+    // deleting the key first guarantees csync_map_thread_exit wont run anymore
+    pthread_key_delete(map->key);
+    csync_map_thread_t *thread = atomic_load_explicit(&map->threads, memory_order_relaxed);
+    while (thread != NULL) {
+        csync_map_thread_t *next = thread->next;
+        for (unsigned int list = 0; list < 3; list++) {
+            for (size_t i = 0; i < thread->count[list]; i++) {
+                free(thread->retired[list][i]);
+            }
+            free(thread->retired[list]);
+        }
+        free(thread);
+        thread = next;
+    }
+    csync_map_table_free(atomic_load_explicit(&map->table, memory_order_relaxed));
+    for (unsigned int i = 0; i < CSYNC_MAP_STRIPES; i++) {
+        csync_lock_destroy(&map->stripes[i].lock);
+    }
+    csync_lock_destroy(&map->resize);
+    free(map->stripes);
+    free(map);
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+/*!
+  * @file mutex.h
+  * @brief a mutual exclusion lock that spins briefly before parking on a futex
+  * @details is roughly equivalent to Golang's sync.Mutex, including its starvation mode
+*/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "futex.h"
+#include "mutex.h"
+
+/*!
+  * @brief the number of pause instructions of a single spin
+*/
+#define CSYNC_MUTEX_SPIN_PAUSES 30
+
+/*!
+  * @brief the number of online cpus, 0 until the first contended lock looked it up
+*/
+static _Atomic long csync_mutex_ncpu = 0;
+
+/*!
+  * @brief will initialize the given csync_mutex_t instance as unlocked
+  * @param mutex a declared but uninitialized csync_mutex_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_mutex_t
+  * @return Failure (mutex == NULL): NULL
+*/
+csync_mutex_t *csync_mutex_new(csync_mutex_t *mutex) {
+    if (mutex == NULL) {
+        mutex = calloc(1, sizeof(csync_mutex_t));
+        if (mutex == NULL) {
+            return NULL;
+        }
+    }
+    atomic_init(&mutex->state, 0);
+    atomic_init(&mutex->sema, 0);
+    return mutex;
+}
+
+/*!
+  * @brief returns whether spinning may help, which is only the case while the holder runs on another cpu
+*/
+static int csync_mutex_can_spin(int iter) {
+    if (iter >= CSYNC_MUTEX_SPINS) {
+        return 0;
+    }
+    long ncpu = atomic_load_explicit(&csync_mutex_ncpu, memory_order_relaxed);
+    if (ncpu == 0) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        atomic_store_explicit(&csync_mutex_ncpu, ncpu, memory_order_relaxed);
+    }
+    return ncpu > 1;
+}
+
+static uint64_t csync_mutex_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/*!
+  * @brief takes one of the wake ups handed out by csync_mutex_unlock_slow, sleeping until there is one
+*/
+static void csync_mutex_sema_acquire(csync_mutex_t *mutex) {
+    uint32_t tokens = atomic_load_explicit(&mutex->sema, memory_order_acquire);
+    for (;;) {
+        if (tokens == 0) {
+            csync_futex_wait(&mutex->sema, 0);
+            tokens = atomic_load_explicit(&mutex->sema, memory_order_acquire);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&mutex->sema, &tokens, tokens - 1, memory_order_acquire, memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+static void csync_mutex_sema_release(csync_mutex_t *mutex) {
+    atomic_fetch_add_explicit(&mutex->sema, 1, memory_order_release);
+    csync_futex_wake(&mutex->sema, 1);
+}
+
+/*!
+  * @brief the contended part of csync_mutex_lock, spins and parks until the mutex is acquired
+*/
+void csync_mutex_lock_slow(csync_mutex_t *mutex) {
+    uint64_t wait_start = 0;
+    int starving = 0;
+    int awoke = 0;
+    int iter = 0;
+    uint32_t state = atomic_load_explicit(&mutex->state, memory_order_relaxed);
+    for (;;) {
+        // don't spin in starvation mode, the mutex is handed to a waiter and we couldn't get it anyway
+        if ((state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_STARVING)) == CSYNC_MUTEX_LOCKED && csync_mutex_can_spin(iter)) {
+            // setting the woken flag tells the holder not to wake a parked waiter we would compete with
+            if (!awoke && (state & CSYNC_MUTEX_WOKEN) == 0 && (state >> CSYNC_MUTEX_WAITER_SHIFT) != 0 &&
+                atomic_compare_exchange_weak_explicit(&mutex->state, &state, state | CSYNC_MUTEX_WOKEN, memory_order_relaxed, memory_order_relaxed)) {
+                awoke = 1;
+            }
+            for (int i = 0; i < CSYNC_MUTEX_SPIN_PAUSES; i++) {
+                CSYNC_CPU_RELAX();
+            }
+            iter++;
+            state = atomic_load_explicit(&mutex->state, memory_order_relaxed);
+            continue;
+        }
+
+        uint32_t next = state;
+        // new threads don't try to take a starving mutex, they queue up behind the waiters
+        if ((state & CSYNC_MUTEX_STARVING) == 0) {
+            next |= CSYNC_MUTEX_LOCKED;
+        }
+        if ((state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_STARVING)) != 0) {
+            next += 1 << CSYNC_MUTEX_WAITER_SHIFT;
+        }
+        // only switch to starvation mode while the mutex is held, unlock expects waiters in starvation mode
+        if (starving && (state & CSYNC_MUTEX_LOCKED) != 0) {
+            next |= CSYNC_MUTEX_STARVING;
+        }
+        if (awoke) {
+            if ((next & CSYNC_MUTEX_WOKEN) == 0) {
+                exit(1);
+            }
+            next &= ~(uint32_t)CSYNC_MUTEX_WOKEN;
+        }
+        if (!atomic_compare_exchange_weak_explicit(&mutex->state, &state, next, memory_order_acquire, memory_order_relaxed)) {
+            continue;
+        }
+        if ((state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_STARVING)) == 0) {
+            // locked with the compare and swap
+            return;
+        }
+
+        if (wait_start == 0) {
+            wait_start = csync_mutex_now();
+        }
+        csync_mutex_sema_acquire(mutex);
+        starving = starving || csync_mutex_now() - wait_start > CSYNC_MUTEX_STARVATION_NS;
+        state = atomic_load_explicit(&mutex->state, memory_order_acquire);
+        if ((state & CSYNC_MUTEX_STARVING) != 0) {
+            // the mutex was handed to us, but it is neither marked locked nor are we removed from the waiters yet
+            if ((state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_WOKEN)) != 0 || (state >> CSYNC_MUTEX_WAITER_SHIFT) == 0) {
+                exit(1);
+            }
+            uint32_t delta = CSYNC_MUTEX_LOCKED - (1 << CSYNC_MUTEX_WAITER_SHIFT);
+            // leave starvation mode if we didn't wait long or are the last waiter, so the mutex doesn't
+            // stay in the slower handoff mode forever
+            if (!starving || (state >> CSYNC_MUTEX_WAITER_SHIFT) == 1) {
+                delta -= CSYNC_MUTEX_STARVING;
+            }
+            atomic_fetch_add_explicit(&mutex->state, delta, memory_order_acquire);
+            return;
+        }
+        awoke = 1;
+        iter = 0;
+    }
+}
+
+/*!
+  * @brief the part of csync_mutex_unlock that wakes or hands the mutex to a waiter
+  * @param state the state right after the locked bit was cleared
+*/
+void csync_mutex_unlock_slow(csync_mutex_t *mutex, uint32_t state) {
+    if (((state + CSYNC_MUTEX_LOCKED) & CSYNC_MUTEX_LOCKED) == 0) {
+        // the mutex wasn't locked
+        exit(1);
+    }
+    if ((state & CSYNC_MUTEX_STARVING) != 0) {
+        // the woken waiter takes the mutex over, new threads don't take it while it is starving
+        csync_mutex_sema_release(mutex);
+        return;
+    }
+    for (;;) {
+        // nobody to wake, or a thread already got the lock, is awake or spinning, and will take care of it
+        if ((state >> CSYNC_MUTEX_WAITER_SHIFT) == 0 || (state & (CSYNC_MUTEX_LOCKED | CSYNC_MUTEX_WOKEN | CSYNC_MUTEX_STARVING)) != 0) {
+            return;
+        }
+        uint32_t next = (state - (1 << CSYNC_MUTEX_WAITER_SHIFT)) | CSYNC_MUTEX_WOKEN;
+        if (atomic_compare_exchange_weak_explicit(&mutex->state, &state, next, memory_order_relaxed, memory_order_relaxed)) {
+            csync_mutex_sema_release(mutex);
+            return;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*!
+  * @file once.h
+  * @brief runs an initializer exactly once, no matter how many threads call it
+  * @details is roughly equivalent to Golang's sync.Once, once initialized a call is a single acquire load
+*/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "futex.h"
+#include "once.h"
+
+/*!
+  * @brief will initialize the given csync_once_t instance
+  * @param once a declared but uninitialized csync_once_t instance, or NULL to allocate one
+  * @return Success: an initialized instance of csync_once_t
+  * @return Failure (once == NULL): NULL
+*/
+csync_once_t *csync_once_new(csync_once_t *once) {
+    if (once == NULL) {
+        once = calloc(1, sizeof(csync_once_t));
+        if (once == NULL) {
+            return NULL;
+        }
+    }
+    atomic_init(&once->state, CSYNC_ONCE_NEW);
+    return once;
+}
+
+/*!
+  * @brief the first part of the slow path, decides whether the caller runs the initializer
+  * @details parks on the futex while another thread runs it
+  * @return 1 if the caller has to run the initializer and then call csync_once_leave, 0 if it completed
+*/
+int csync_once_enter(csync_once_t *once) {
+    uint32_t state = atomic_load_explicit(&once->state, memory_order_acquire);
+    for (;;) {
+        switch (state) {
+        case CSYNC_ONCE_DONE:
+            return 0;
+        case CSYNC_ONCE_NEW:
+            if (atomic_compare_exchange_weak_explicit(&once->state, &state, CSYNC_ONCE_RUNNING, memory_order_acquire, memory_order_acquire)) {
+                return 1;
+            }
+            break;
+        case CSYNC_ONCE_RUNNING:
+            // tell the running thread to wake us once it is done
+            if (!atomic_compare_exchange_weak_explicit(&once->state, &state, CSYNC_ONCE_PARKED, memory_order_acquire, memory_order_acquire)) {
+                break;
+            }
+            // fall through
+        default:
+            csync_futex_wait(&once->state, CSYNC_ONCE_PARKED);
+            state = atomic_load_explicit(&once->state, memory_order_acquire);
+            break;
+        }
+    }
+}
+
+/*!
+  * @brief publishes the result of an initializer run after csync_once_enter returned 1, waking the parked threads
+  * @param once an initialized instance of csync_once_t
+  * @param done 1 if the initializer completed, 0 to let the next caller try again
+*/
+void csync_once_leave(csync_once_t *once, int done) {
+    // after a failure every parked thread races to become the next one to run the initializer
+    uint32_t state = atomic_exchange_explicit(&once->state, done ? CSYNC_ONCE_DONE : CSYNC_ONCE_NEW, memory_order_release);
+    if (state == CSYNC_ONCE_PARKED) {
+        csync_futex_wake(&once->state, INT32_MAX);
+    }
+}
\ No newline at end of file
@@ -2,14 +2,1049 @@
   * @file pool.h
   * @brief allows reuse memory allocated objects to reduce overall memory allocations at the expense of increase memory consumption
   * @details it does this by allowing you to store objects when you are done with them
-  * @details it is not suitable for memory constrained environments as it doesnt deallocate
-  * @details the memory allocated for the objects when they arent in use
+  * @details the memory allocated for objects that arent in use is only given back by trimming
+  * @details the pool, either through csync_pool_trim or a background ticker
 */
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "once.h"
 #include "pool.h"
 
+#if CSYNC_POOL_STATS
+/*!
+  * @brief adds num to a counter of the calling thread's cache, or of the pool if the thread has none
+  * @details thread counters have a single writer, so a relaxed load and store is enough
+*/
+#define CSYNC_POOL_COUNT(pool, local, field, num)                                                                      \
+    do {                                                                                                               \
+        if ((local) != NULL) {                                                                                         \
+            atomic_store_explicit(&(local)->stats.field,                                                               \
+                                  atomic_load_explicit(&(local)->stats.field, memory_order_relaxed) + (num),           \
+                                  memory_order_relaxed);                                                               \
+        } else {                                                                                                       \
+            atomic_fetch_add_explicit(&(pool)->stats.field, (num), memory_order_relaxed);                             \
+        }                                                                                                              \
+    } while (0)
+#else
+#define CSYNC_POOL_COUNT(pool, local, field, num) ((void)(local), (void)(num))
+#endif
+
+/*!
+  * @brief the key of the table of caches of every thread, created by the first pool
+*/
+static pthread_key_t csync_pool_key;
+static csync_once_t csync_pool_key_once = CSYNC_ONCE_INIT;
+
+/*!
+  * @brief guards csync_pool_ids, which holds the gen of the pool using every id, or 0 if the id is free
+*/
+static pthread_mutex_t csync_pool_ids_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t *csync_pool_ids;
+static unsigned int csync_pool_nids;
+static uint64_t csync_pool_next_gen = 1;
+
+/*!
+  * @brief returns the calling thread's cache without creating it
+  * @return Success: the calling thread's cache
+  * @return Failure: NULL if the thread has none, or is exiting
+*/
+static csync_pool_local_t *csync_pool_local_peek(csync_pool_t *pool) {
+    csync_pool_table_t *table = pthread_getspecific(csync_pool_key);
+    if (table == NULL || pool->id >= table->size || table->slots[pool->id].gen != pool->gen) {
+        return NULL;
+    }
+    return table->slots[pool->id].local;
+}
+
+/*!
+  * @brief locks pool->mutex, accounting the time spent waiting if another thread holds it
+  * @details every path taking the mutex goes through here, so lock_wait_ns covers all of them
+  * @details the clock is only read when the lock is contended, so the uncontended path costs a trylock
+*/
+static void csync_pool_lock(csync_pool_t *pool) {
+#if CSYNC_POOL_STATS
+    if (csync_lock_trylock(&pool->mutex) == 0) {
+        return;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    csync_lock_lock(&pool->mutex);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t elapsed = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+    // NULL while a thread is exiting, the time is then counted for the pool
+    csync_pool_local_t *local = csync_pool_local_peek(pool);
+    CSYNC_POOL_COUNT(pool, local, lock_wait_ns, elapsed);
+#else
+    csync_lock_lock(&pool->mutex);
+#endif
+}
+
+/*!
+  * @brief accounts num objects being added to the shared tier, enforcing the cap and updating the high-water mark
+  * @details called before the objects are stored so that shared_idle never drops below the actual count
+  * @return the number of objects that don't fit under the cap, and must not be stored
+*/
+static unsigned int csync_pool_idle_add(csync_pool_t *pool, unsigned int num) {
+    uint64_t idle = atomic_fetch_add_explicit(&pool->shared_idle, num, memory_order_relaxed) + num;
+    unsigned int excess = 0;
+    if (pool->cap != 0 && idle > pool->cap) {
+        excess = idle - num >= pool->cap ? num : (unsigned int)(idle - pool->cap);
+        atomic_fetch_sub_explicit(&pool->shared_idle, excess, memory_order_relaxed);
+        idle -= excess;
+    }
+#if CSYNC_POOL_STATS
+    uint64_t peak = atomic_load_explicit(&pool->shared_peak_idle, memory_order_relaxed);
+    while (idle > peak && !atomic_compare_exchange_weak_explicit(&pool->shared_peak_idle, &peak, idle, memory_order_relaxed, memory_order_relaxed)) {
+    }
+#endif
+    return excess;
+}
+
+/*!
+  * @brief accounts num objects being taken out of the shared tier, after they have been taken
+*/
+static void csync_pool_idle_sub(csync_pool_t *pool, unsigned int num) {
+    atomic_fetch_sub_explicit(&pool->shared_idle, num, memory_order_relaxed);
+}
+
+/*!
+  * @brief makes sure the shared tier has room for needed more objects
+  * @note the caller must hold pool->mutex
+*/
+static void csync_pool_reserve(csync_pool_t *pool, unsigned int needed) {
+    if (pool->count + needed <= pool->size) {
+        return;
+    }
+    if (pool->size == 0) {
+        pool->size = 1;
+    }
+    while (pool->count + needed > pool->size) {
+        // increase size by 2
+        pool->size *= 2;
+    }
+    // reallocate the memory
+    pool->resizes += 1;
+    pool->items = realloc(pool->items, pool->size * sizeof(void *));
+    if (pool->items == NULL) {
+        // todo: gracefully handle
+        exit(1);
+    }
+}
+
+/*!
+  * @brief returns the lock-free node with the given 1 based index
+  * @details chunk n holds pool->size << n nodes, so the chunk is found through the highest set bit of index - 1 + pool->size
+*/
+static csync_pool_node_t *csync_pool_node(csync_pool_t *pool, uint32_t index) {
+    uint32_t pos = index - 1 + pool->size;
+    unsigned int high = 31 - __builtin_clz(pos);
+    unsigned int chunk = high - __builtin_ctz(pool->size);
+    csync_pool_node_t *nodes = atomic_load_explicit(&pool->chunks[chunk], memory_order_acquire);
+    return &nodes[pos - (1u << high)];
+}
+
+/*!
+  * @brief pops a node from a lock-free stack
+  * @details every successful CAS bumps the generation in the upper 32 bits of the head
+  * @details so a stale head can never be swapped in even if the same node was pushed again
+  * @return Success: the 1 based index of the node
+  * @return Failure: 0 if the stack is empty
+*/
+static uint32_t csync_pool_stack_pop(csync_pool_t *pool, _Atomic uint64_t *stack) {
+    uint64_t head = atomic_load_explicit(stack, memory_order_acquire);
+    for (;;) {
+        uint32_t index = (uint32_t)head;
+        if (index == 0) {
+            return 0;
+        }
+        // nodes are never freed, so reading next is safe even if another thread popped the node
+        uint32_t next = atomic_load_explicit(&csync_pool_node(pool, index)->next, memory_order_relaxed);
+        uint64_t update = (((head >> 32) + 1) << 32) | next;
+        if (atomic_compare_exchange_weak_explicit(stack, &head, update, memory_order_acquire, memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+/*!
+  * @brief pushes the node with the given 1 based index onto a lock-free stack
+*/
+static void csync_pool_stack_push(csync_pool_t *pool, _Atomic uint64_t *stack, uint32_t index) {
+    csync_pool_node_t *node = csync_pool_node(pool, index);
+    uint64_t head = atomic_load_explicit(stack, memory_order_relaxed);
+    uint64_t update;
+    do {
+        atomic_store_explicit(&node->next, (uint32_t)head, memory_order_relaxed);
+        update = (((head >> 32) + 1) << 32) | index;
+    } while (!atomic_compare_exchange_weak_explicit(stack, &head, update, memory_order_release, memory_order_relaxed));
+}
+
+/*!
+  * @brief returns an unused lock-free node, allocating a new chunk of nodes if needed
+  * @return Success: the 1 based index of the node
+  * @return Failure: 0 if the node storage can't grow anymore
+*/
+static uint32_t csync_pool_node_new(csync_pool_t *pool) {
+    uint32_t index = csync_pool_stack_pop(pool, &pool->free_nodes);
+    if (index != 0) {
+        return index;
+    }
+
+    csync_pool_lock(pool);
+    // another thread may have grown the storage while we were waiting
+    index = csync_pool_stack_pop(pool, &pool->free_nodes);
+    unsigned int chunk = pool->nchunks;
+    // stop before indexes no longer fit into 32 bits
+    if (index != 0 || chunk >= CSYNC_POOL_MAX_CHUNKS || ((uint64_t)pool->size << (chunk + 1)) > ((uint64_t)1 << 32)) {
+        csync_lock_unlock(&pool->mutex);
+        return index;
+    }
+    uint32_t num = pool->size << chunk;
+    csync_pool_node_t *nodes = calloc(num, sizeof(csync_pool_node_t));
+    if (nodes == NULL) {
+        csync_lock_unlock(&pool->mutex);
+        return 0;
+    }
+    atomic_store_explicit(&pool->chunks[chunk], nodes, memory_order_release);
+    pool->nchunks += 1;
+    pool->resizes += 1;
+    csync_lock_unlock(&pool->mutex);
+
+    // the first index of chunk n is (pool->size << n) - pool->size + 1
+    uint32_t first = num - pool->size + 1;
+    for (uint32_t i = 1; i < num; i++) {
+        csync_pool_stack_push(pool, &pool->free_nodes, first + i);
+    }
+    return first;
+}
+
+/*!
+  * @brief maps a prefaulted arena of size bytes aligned to size, preferably backed by huge pages
+  * @details the kernel usually aligns large anonymous mappings already, otherwise twice the size
+  * @details is reserved and the aligned part is cut out of it
+  * @return Success: the start of the arena
+  * @return Failure: NULL if no memory could be mapped
+*/
+static void *csync_pool_arena_map(size_t size) {
+    char *arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (arena != MAP_FAILED && ((uintptr_t)arena & (size - 1)) == 0) {
+        // collapsed into huge pages by khugepaged if they weren't used when faulting
+        madvise(arena, size, MADV_HUGEPAGE);
+        return arena;
+    }
+    if (arena != MAP_FAILED) {
+        munmap(arena, size);
+    }
+
+    char *raw = mmap(NULL, size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    arena = (char *)(((uintptr_t)raw + size - 1) & ~(uintptr_t)(size - 1));
+    if (arena != raw) {
+        munmap(raw, (size_t)(arena - raw));
+    }
+    munmap(arena + size, (size_t)(raw + size * 2 - (arena + size)));
+    // advise before faulting so the pages are huge from the start
+    madvise(arena, size, MADV_HUGEPAGE);
+#ifdef MADV_POPULATE_WRITE
+    madvise(arena, size, MADV_POPULATE_WRITE);
+#endif
+    return arena;
+}
+
+/*!
+  * @brief allocates a new slab for a fixed size pool
+  * @details pools created with CSYNC_POOL_HUGEPAGES fall back to the heap if the arena can't be mapped
+  * @return Success: a slab aligned to pool->slab_size
+  * @return Failure: NULL
+*/
+static csync_pool_slab_t *csync_pool_slab_alloc(csync_pool_t *pool) {
+    csync_pool_slab_t *slab = NULL;
+    if (pool->flags & CSYNC_POOL_HUGEPAGES) {
+        slab = csync_pool_arena_map(pool->slab_size);
+    }
+    if (slab != NULL) {
+        slab->mapped = 1;
+    } else {
+        slab = aligned_alloc(pool->slab_size, pool->slab_size);
+        if (slab == NULL) {
+            return NULL;
+        }
+        slab->mapped = 0;
+    }
+    slab->idle = 0;
+    return slab;
+}
+
+/*!
+  * @brief frees a slab returned by csync_pool_slab_alloc
+*/
+static void csync_pool_slab_free(csync_pool_t *pool, csync_pool_slab_t *slab) {
+    if (slab->mapped) {
+        munmap(slab, pool->slab_size);
+    } else {
+        free(slab);
+    }
+}
+
+/*!
+  * @brief gives the memory of a list of slabs unlinked by trimming back
+  * @details heap slabs are freed, while arenas are decommitted with MADV_DONTNEED, except for the page
+  * @details holding the header, and are kept in pool->decommitted so the mapping can be reused
+  * @note the caller must not hold pool->mutex
+*/
+static void csync_pool_slab_retire(csync_pool_t *pool, csync_pool_slab_t *released) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    while (released != NULL) {
+        csync_pool_slab_t *next = released->next;
+        if (!released->mapped) {
+            free(released);
+        } else {
+            madvise((char *)released + page, pool->slab_size - page, MADV_DONTNEED);
+            released->idle = 0;
+            csync_pool_lock(pool);
+            released->next = pool->decommitted;
+            pool->decommitted = released;
+            csync_lock_unlock(&pool->mutex);
+        }
+        released = next;
+    }
+}
+
+/*!
+  * @brief carves up to num never used objects out of the slab of a thread cache in a fixed size pool
+  * @details a new slab is only allocated when the current one is used up, without holding the mutex
+  * @details and decommitted arenas are reused before mapping new ones
+  * @param local the cache that will own the objects, NULL to carve from the slab shared by threads without one
+  * @return the number of objects stored in items, 0 if a slab couldn't be allocated
+*/
+static unsigned int csync_pool_slab_carve(csync_pool_t *pool, csync_pool_local_t *local, void **items, unsigned int num) {
+    csync_pool_carve_t *carve = local != NULL ? &local->carve : &pool->carve;
+    csync_pool_slab_t *slab = NULL;
+    csync_pool_lock(pool);
+    while (carve->next == carve->end) {
+        if (slab == NULL && pool->decommitted != NULL) {
+            slab = pool->decommitted;
+            pool->decommitted = slab->next;
+        }
+        if (slab != NULL) {
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->resizes += 1;
+            slab->owner = local;
+            carve->slab = slab;
+            carve->next = (char *)slab + pool->obj_offset;
+            carve->end = carve->next + (pool->slab_size - pool->obj_offset) / pool->obj_size * pool->obj_size;
+            slab = NULL;
+            break;
+        }
+        // dont block other threads while allocating, and check again if a slab is still needed afterwards
+        // as a decommitted arena may have become available
+        csync_lock_unlock(&pool->mutex);
+        slab = csync_pool_slab_alloc(pool);
+        if (slab == NULL) {
+            return 0;
+        }
+        csync_pool_lock(pool);
+    }
+    unsigned int count = 0;
+    while (count < num && carve->next < carve->end) {
+        items[count] = carve->next;
+        carve->next += pool->obj_size;
+        count += 1;
+    }
+    csync_lock_unlock(&pool->mutex);
+
+    // a decommitted arena became available while we were allocating ours
+    if (slab != NULL) {
+        csync_pool_slab_free(pool, slab);
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        memset(items[i], 0, pool->obj_size);
+    }
+    return count;
+}
+
+/*!
+  * @brief creates a new object for a pool that had no stored objects
+  * @return Success: a new object
+  * @return Failure: NULL, or always if the pool has no alloc_fn
+*/
+static void *csync_pool_alloc_object(csync_pool_t *pool, csync_pool_local_t *local) {
+    if (pool->obj_size == 0) {
+        return pool->alloc_fn != NULL ? pool->alloc_fn() : NULL;
+    }
+    void *item;
+    if (csync_pool_slab_carve(pool, local, &item, 1) == 0) {
+        return NULL;
+    }
+    return item;
+}
+
+/*!
+  * @brief gives up on an object the pool can no longer hold on to
+  * @details objects of fixed size pools stay in their slab until the pool is destroyed
+*/
+static void csync_pool_free_object(csync_pool_t *pool, void *item) {
+    CSYNC_POOL_COUNT(pool, (csync_pool_local_t *)NULL, frees, 1);
+    if (pool->obj_size == 0) {
+        pool->free_fn(item);
+    }
+}
+
+/*!
+  * @brief takes all nodes off of a lock-free stack at once
+  * @return the 1 based index of the first node of the detached chain, 0 if the stack was empty
+*/
+static uint32_t csync_pool_stack_detach(_Atomic uint64_t *stack) {
+    uint64_t head = atomic_load_explicit(stack, memory_order_acquire);
+    while (!atomic_compare_exchange_weak_explicit(stack, &head, ((head >> 32) + 1) << 32, memory_order_acquire, memory_order_acquire)) {
+    }
+    return (uint32_t)head;
+}
+
+/*!
+  * @brief returns the slab an object of a fixed size pool was carved from
+*/
+static csync_pool_slab_t *csync_pool_slab_of(csync_pool_t *pool, void *item) {
+    return (csync_pool_slab_t *)((uintptr_t)item & ~(uintptr_t)(pool->slab_size - 1));
+}
+
+/*!
+  * @brief returns the number of objects that have been carved from a slab
+  * @note the caller must hold pool->mutex
+*/
+static unsigned int csync_pool_slab_carved(csync_pool_t *pool, csync_pool_slab_t *slab) {
+    csync_pool_carve_t *carve = slab->owner != NULL ? &slab->owner->carve : &pool->carve;
+    if (carve->slab == slab) {
+        return (unsigned int)((carve->next - ((char *)slab + pool->obj_offset)) / pool->obj_size);
+    }
+    return (unsigned int)((pool->slab_size - pool->obj_offset) / pool->obj_size);
+}
+
+/*!
+  * @brief unlinks every slab whose carved objects are all counted as idle
+  * @details the idle count of the returned slabs is left untouched so csync_pool_slab_released
+  * @details can still tell their objects apart, while it is reset for all other slabs
+  * @note the caller must hold pool->mutex and have counted the idle objects of every slab
+  * @return the list of unlinked slabs, which the caller has to free
+*/
+static csync_pool_slab_t *csync_pool_slab_release(csync_pool_t *pool) {
+    csync_pool_slab_t *released = NULL;
+    csync_pool_slab_t **link = &pool->slabs;
+    while (*link != NULL) {
+        csync_pool_slab_t *slab = *link;
+        if (slab->idle == 0 || slab->idle != csync_pool_slab_carved(pool, slab)) {
+            slab->idle = 0;
+            link = &slab->next;
+            continue;
+        }
+        csync_pool_carve_t *carve = slab->owner != NULL ? &slab->owner->carve : &pool->carve;
+        if (carve->slab == slab) {
+            carve->slab = NULL;
+            carve->next = NULL;
+            carve->end = NULL;
+        }
+        *link = slab->next;
+        CSYNC_POOL_COUNT(pool, (csync_pool_local_t *)NULL, frees, slab->idle);
+        csync_pool_idle_sub(pool, slab->idle);
+        slab->next = released;
+        released = slab;
+    }
+    return released;
+}
+
+/*!
+  * @brief returns whether the object belongs to a slab returned by csync_pool_slab_release
+*/
+static int csync_pool_slab_released(csync_pool_t *pool, void *item) {
+    return csync_pool_slab_of(pool, item)->idle != 0;
+}
+
+/*!
+  * @brief pops up to num objects from the lock-free stack into items, filling it from the back
+  * @return the number of objects stored in items
+*/
+static unsigned int csync_pool_stack_pop_items(csync_pool_t *pool, _Atomic uint64_t *stack, void **items, unsigned int num) {
+    unsigned int count = 0;
+    while (count < num) {
+        uint32_t index = csync_pool_stack_pop(pool, stack);
+        if (index == 0) {
+            break;
+        }
+        items[num - count - 1] = csync_pool_node(pool, index)->item;
+        csync_pool_stack_push(pool, &pool->free_nodes, index);
+        count += 1;
+    }
+    return count;
+}
+
+/*!
+  * @brief pops up to num objects from the free list into items, filling it from the back
+  * @note the caller must hold pool->mutex
+  * @return the number of objects stored in items
+*/
+static unsigned int csync_pool_list_pop_items(void **list, void **items, unsigned int num) {
+    unsigned int count = 0;
+    while (count < num && *list != NULL) {
+        void *item = *list;
+        *list = *(void **)item;
+        items[num - count - 1] = item;
+        count += 1;
+    }
+    return count;
+}
+
+/*!
+  * @brief takes up to num of the most recently stored objects out of the shared tier
+  * @details objects of the current generation are preferred over the victim generation
+  * @details the objects are stored oldest first, matching the order of the items array
+  * @return the number of objects stored in items
+*/
+static unsigned int csync_pool_shared_pop(csync_pool_t *pool, void **items, unsigned int num) {
+    unsigned int count;
+    if (pool->flags & CSYNC_POOL_LOCKFREE) {
+        count = csync_pool_stack_pop_items(pool, &pool->head, items, num);
+        count += csync_pool_stack_pop_items(pool, &pool->victim_head, items, num - count);
+    } else if (pool->obj_size != 0) {
+        csync_pool_lock(pool);
+        count = csync_pool_list_pop_items(&pool->free_list, items, num);
+        count += csync_pool_list_pop_items(&pool->victim_list, items, num - count);
+        csync_lock_unlock(&pool->mutex);
+    } else {
+        csync_pool_lock(pool);
+        unsigned int fresh = num < pool->count ? num : pool->count;
+        unsigned int old = num - fresh < pool->victim_count ? num - fresh : pool->victim_count;
+        if (fresh > 0) {
+            pool->count -= fresh;
+            memcpy(items + num - fresh, pool->items + pool->count, fresh * sizeof(void *));
+        }
+        if (old > 0) {
+            pool->victim_count -= old;
+            memcpy(items + num - fresh - old, pool->victim + pool->victim_count, old * sizeof(void *));
+        }
+        csync_lock_unlock(&pool->mutex);
+        count = fresh + old;
+    }
+    csync_pool_idle_sub(pool, count);
+    if (count > 0 && count < num) {
+        memmove(items, items + num - count, count * sizeof(void *));
+    }
+    return count;
+}
+
+/*!
+  * @brief stores num objects into the shared tier
+*/
+static void csync_pool_shared_push(csync_pool_t *pool, void **items, unsigned int num) {
+    unsigned int excess = csync_pool_idle_add(pool, num);
+    // give up on the oldest objects if the shared tier is full
+    for (unsigned int i = 0; i < excess; i++) {
+        csync_pool_free_object(pool, items[i]);
+    }
+    items += excess;
+    num -= excess;
+    if (pool->flags & CSYNC_POOL_LOCKFREE) {
+        for (unsigned int i = 0; i < num; i++) {
+            uint32_t index = csync_pool_node_new(pool);
+            if (index == 0) {
+                // the node storage is exhausted, so we can't hold on to the object
+                csync_pool_idle_sub(pool, 1);
+                csync_pool_free_object(pool, items[i]);
+                continue;
+            }
+            csync_pool_node(pool, index)->item = items[i];
+            csync_pool_stack_push(pool, &pool->head, index);
+        }
+        return;
+    }
+
+    if (pool->obj_size != 0) {
+        csync_pool_lock(pool);
+        for (unsigned int i = 0; i < num; i++) {
+            *(void **)items[i] = pool->free_list;
+            pool->free_list = items[i];
+        }
+        csync_lock_unlock(&pool->mutex);
+        return;
+    }
+
+    csync_pool_lock(pool);
+    csync_pool_reserve(pool, num);
+    memcpy(pool->items + pool->count, items, num * sizeof(void *));
+    pool->count += num;
+    csync_lock_unlock(&pool->mutex);
+}
+
+/*!
+  * @brief stores a list of objects linked through their first bytes into the shared tier
+*/
+static void csync_pool_chain_push(csync_pool_t *pool, void *list) {
+    void *items[CSYNC_POOL_LOCAL_SIZE];
+    while (list != NULL) {
+        unsigned int count = 0;
+        // read the links of the whole batch first, as storing the objects overwrites them
+        while (count < CSYNC_POOL_LOCAL_SIZE && list != NULL) {
+            items[count] = list;
+            list = *(void **)list;
+            count += 1;
+        }
+        csync_pool_shared_push(pool, items, count);
+    }
+}
+
+/*!
+  * @brief returns the cache an object put by the owner of local has to be handed back to
+  * @return Success: the cache of the thread that carved the object
+  * @return Failure: NULL if local keeps the object, because it carved it, the object isn't
+  * @return Failure: part of a fixed size pool, or the thread that carved it exited
+*/
+static csync_pool_local_t *csync_pool_remote_owner(csync_pool_t *pool, csync_pool_local_t *local, void *item) {
+    if (pool->obj_size == 0) {
+        return NULL;
+    }
+    csync_pool_local_t *owner = csync_pool_slab_of(pool, item)->owner;
+    if (owner == local || owner == NULL || atomic_load_explicit(&owner->abandoned, memory_order_relaxed)) {
+        return NULL;
+    }
+    return owner;
+}
+
+/*!
+  * @brief pushes a list of objects running from first to last onto the remote queue of a cache
+  * @details any number of threads may push at once, while only the owner takes the whole queue at once
+  * @details with an exchange, so unlike popping single objects this can't suffer from ABA
+*/
+static void csync_pool_remote_push(csync_pool_local_t *owner, void *first, void *last) {
+    void *head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+    do {
+        *(void **)last = head;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->remote, &head, first, memory_order_release, memory_order_relaxed));
+}
+
+/*!
+  * @brief takes up to num of the objects other threads returned to a cache
+  * @details the remote queue is only drained once the objects drained before are used up
+  * @return the number of objects stored in items
+*/
+static unsigned int csync_pool_returned_pop(csync_pool_local_t *local, void **items, unsigned int num) {
+    if (local->returned == NULL && atomic_load_explicit(&local->remote, memory_order_relaxed) != NULL) {
+        local->returned = atomic_exchange_explicit(&local->remote, NULL, memory_order_acquire);
+    }
+    unsigned int count = 0;
+    while (count < num && local->returned != NULL) {
+        items[count] = local->returned;
+        local->returned = *(void **)local->returned;
+        count += 1;
+    }
+    return count;
+}
+
+/*!
+  * @brief moves the objects returned to the caches of exited threads into the shared tier
+  * @details so that they can be trimmed, as nobody would take them off of the remote queues otherwise
+*/
+static void csync_pool_trim_abandoned(csync_pool_t *pool) {
+    void *list = NULL;
+    csync_pool_lock(pool);
+    for (csync_pool_local_t *local = pool->locals; local != NULL; local = local->next) {
+        if (!atomic_load_explicit(&local->abandoned, memory_order_relaxed)) {
+            continue;
+        }
+        void *remote = atomic_exchange_explicit(&local->remote, NULL, memory_order_acquire);
+        while (remote != NULL) {
+            void *next = *(void **)remote;
+            *(void **)remote = list;
+            list = remote;
+            remote = next;
+        }
+    }
+    csync_lock_unlock(&pool->mutex);
+
+    csync_pool_chain_push(pool, list);
+}
+
+/*!
+  * @brief trims a pool using the lock-free shared tier
+*/
+static void csync_pool_trim_lockfree(csync_pool_t *pool) {
+    csync_pool_lock(pool);
+    uint32_t victims = csync_pool_stack_detach(&pool->victim_head);
+    uint32_t index = csync_pool_stack_detach(&pool->head);
+    while (index != 0) {
+        uint32_t next = atomic_load_explicit(&csync_pool_node(pool, index)->next, memory_order_relaxed);
+        csync_pool_stack_push(pool, &pool->victim_head, index);
+        index = next;
+    }
+
+    if (pool->obj_size == 0) {
+        csync_lock_unlock(&pool->mutex);
+        while (victims != 0) {
+            csync_pool_node_t *node = csync_pool_node(pool, victims);
+            uint32_t next = atomic_load_explicit(&node->next, memory_order_relaxed);
+            pool->free_fn(node->item);
+            csync_pool_stack_push(pool, &pool->free_nodes, victims);
+            CSYNC_POOL_COUNT(pool, (csync_pool_local_t *)NULL, frees, 1);
+            csync_pool_idle_sub(pool, 1);
+            victims = next;
+        }
+        return;
+    }
+
+    for (index = victims; index != 0; index = atomic_load_explicit(&csync_pool_node(pool, index)->next, memory_order_relaxed)) {
+        csync_pool_slab_of(pool, csync_pool_node(pool, index)->item)->idle += 1;
+    }
+    csync_pool_slab_t *released = csync_pool_slab_release(pool);
+    while (victims != 0) {
+        csync_pool_node_t *node = csync_pool_node(pool, victims);
+        uint32_t next = atomic_load_explicit(&node->next, memory_order_relaxed);
+        // objects of slabs that are still in use stay in the victim generation
+        if (csync_pool_slab_released(pool, node->item)) {
+            csync_pool_stack_push(pool, &pool->free_nodes, victims);
+        } else {
+            csync_pool_stack_push(pool, &pool->victim_head, victims);
+        }
+        victims = next;
+    }
+    csync_lock_unlock(&pool->mutex);
+
+    csync_pool_slab_retire(pool, released);
+}
+
+/*!
+  * @brief trims a fixed size pool using the mutex guarded free lists
+*/
+static void csync_pool_trim_fixed(csync_pool_t *pool) {
+    csync_pool_lock(pool);
+    for (void *item = pool->victim_list; item != NULL; item = *(void **)item) {
+        csync_pool_slab_of(pool, item)->idle += 1;
+    }
+    csync_pool_slab_t *released = csync_pool_slab_release(pool);
+
+    // objects of slabs that are still in use stay in the victim generation
+    void **link = &pool->victim_list;
+    while (*link != NULL) {
+        if (csync_pool_slab_released(pool, *link)) {
+            *link = *(void **)*link;
+        } else {
+            link = (void **)*link;
+        }
+    }
+    *link = pool->free_list;
+    pool->free_list = NULL;
+    csync_lock_unlock(&pool->mutex);
+
+    csync_pool_slab_retire(pool, released);
+}
+
+/*!
+  * @brief frees the objects that have been idle since the previous trim
+  * @details objects stored in the shared tier move to a victim generation, which is still used
+  * @details by csync_pool_get but only after the current generation is empty, and whatever
+  * @details is left in the victim generation by the next trim is passed to free_fn
+  * @details fixed size pools instead free every slab whose objects are all in the victim generation
+  * @details threads move the objects in their cache to the shared tier the next time they use the pool after a trim
+  * @note objects cached by threads that don't use the pool anymore are not trimmed
+*/
+void csync_pool_trim(csync_pool_t *pool) {
+    atomic_fetch_add_explicit(&pool->epoch, 1, memory_order_relaxed);
+    if (pool->obj_size != 0) {
+        csync_pool_trim_abandoned(pool);
+    }
+
+    if (pool->flags & CSYNC_POOL_LOCKFREE) {
+        csync_pool_trim_lockfree(pool);
+        return;
+    }
+    if (pool->obj_size != 0) {
+        csync_pool_trim_fixed(pool);
+        return;
+    }
+
+    csync_pool_lock(pool);
+    void **victims = pool->victim;
+    unsigned int count = pool->victim_count;
+    pool->victim = pool->items;
+    pool->victim_count = pool->count;
+    // the current generation starts out empty, and is grown again by csync_pool_reserve
+    pool->items = NULL;
+    pool->count = 0;
+    pool->size = 0;
+    csync_lock_unlock(&pool->mutex);
+
+    for (unsigned int i = 0; i < count; i++) {
+        pool->free_fn(victims[i]);
+    }
+    free(victims);
+    CSYNC_POOL_COUNT(pool, (csync_pool_local_t *)NULL, frees, count);
+    csync_pool_idle_sub(pool, count);
+}
+
+/*!
+  * @brief periodically trims the pool until csync_pool_ticker_stop is called
+*/
+static void *csync_pool_ticker(void *data) {
+    csync_pool_t *pool = (csync_pool_t *)data;
+
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += pool->ticker_interval / 1000;
+        deadline.tv_nsec += (long)(pool->ticker_interval % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        if (csync_event_wait_until(&pool->ticker_stop, &deadline) == 0) {
+            break;
+        }
+        csync_pool_trim(pool);
+    }
+
+    return NULL;
+}
+
+/*!
+  * @brief starts a background thread calling csync_pool_trim every interval_ms milliseconds
+  * @details objects are freed after being idle for between one and two intervals
+  * @param pool an initialized instance of csync_pool_t
+  * @param interval_ms the time between two trims
+  * @return Success: 0
+  * @return Failure: EBUSY if the ticker is already running, or the error returned by pthread_create
+*/
+int csync_pool_ticker_start(csync_pool_t *pool, unsigned int interval_ms) {
+    csync_pool_lock(pool);
+    if (pool->ticker_running) {
+        csync_lock_unlock(&pool->mutex);
+        return EBUSY;
+    }
+    pool->ticker_interval = interval_ms;
+    pool->ticker_running = 1;
+    csync_event_reset(&pool->ticker_stop);
+    int rc = pthread_create(&pool->ticker, NULL, csync_pool_ticker, pool);
+    if (rc != 0) {
+        pool->ticker_running = 0;
+    }
+    csync_lock_unlock(&pool->mutex);
+    return rc;
+}
+
+/*!
+  * @brief stops the background thread started by csync_pool_ticker_start
+  * @details does nothing if the ticker isn't running
+*/
+void csync_pool_ticker_stop(csync_pool_t *pool) {
+    csync_pool_lock(pool);
+    if (!pool->ticker_running) {
+        csync_lock_unlock(&pool->mutex);
+        return;
+    }
+    pool->ticker_running = 0;
+    csync_event_set(&pool->ticker_stop);
+    csync_lock_unlock(&pool->mutex);
+
+    pthread_join(pool->ticker, NULL);
+}
+
+/*!
+  * @brief moves all objects held by a thread cache into the shared tier
+  * @details including the objects other threads returned to it
+*/
+static void csync_pool_local_flush(csync_pool_t *pool, csync_pool_local_t *local) {
+    csync_pool_shared_push(pool, local->items, local->count);
+    local->count = 0;
+    if (pool->obj_size != 0) {
+        csync_pool_chain_push(pool, local->returned);
+        local->returned = NULL;
+        csync_pool_chain_push(pool, atomic_exchange_explicit(&local->remote, NULL, memory_order_acquire));
+    }
+}
+
+/*!
+  * @brief moves all objects cached by a thread back into the shared tier and abandons its cache
+  * @details the cache stays linked into the pool, as other threads may still hold objects it owns
+*/
+static void csync_pool_local_exit(csync_pool_local_t *local) {
+    csync_pool_t *pool = local->pool;
+
+    csync_pool_local_flush(pool, local);
+
+    csync_pool_lock(pool);
+    atomic_store_explicit(&local->abandoned, 1, memory_order_relaxed);
+    csync_lock_unlock(&pool->mutex);
+}
+
+/*!
+  * @brief abandons the caches of an exiting thread for every pool that still exists
+  * @details registered as the destructor of csync_pool_key so it runs whenever a thread exits
+  * @details the pools are pinned through their exiting count rather than by holding the id lock,
+  * @details so flushing, which may call free_fn, doesn't block other threads creating or destroying pools
+*/
+static void csync_pool_table_exit(void *data) {
+    csync_pool_table_t *table = (csync_pool_table_t *)data;
+    pthread_mutex_lock(&csync_pool_ids_lock);
+    for (unsigned int i = 0; i < table->size; i++) {
+        csync_pool_slot_t *slot = &table->slots[i];
+        if (slot->local == NULL || i >= csync_pool_nids || csync_pool_ids[i] != slot->gen) {
+            // the pool was destroyed along with the cache
+            slot->local = NULL;
+            continue;
+        }
+        atomic_fetch_add_explicit(&slot->local->pool->exiting, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&csync_pool_ids_lock);
+
+    for (unsigned int i = 0; i < table->size; i++) {
+        csync_pool_local_t *local = table->slots[i].local;
+        if (local != NULL) {
+            csync_pool_t *pool = local->pool;
+            csync_pool_local_exit(local);
+            atomic_fetch_sub_explicit(&pool->exiting, 1, memory_order_release);
+        }
+    }
+    free(table);
+}
+
+static int csync_pool_key_create(void *arg) {
+    (void)arg;
+    return pthread_key_create(&csync_pool_key, csync_pool_table_exit);
+}
+
+/*!
+  * @brief assigns the pool the lowest free id and a new gen
+  * @return Success: 0
+  * @return Failure: ENOMEM if the ids couldn't grow
+*/
+static int csync_pool_id_new(csync_pool_t *pool) {
+    pthread_mutex_lock(&csync_pool_ids_lock);
+    unsigned int id = 0;
+    while (id < csync_pool_nids && csync_pool_ids[id] != 0) {
+        id++;
+    }
+    if (id == csync_pool_nids) {
+        unsigned int nids = csync_pool_nids ? csync_pool_nids * 2 : 16;
+        uint64_t *ids = realloc(csync_pool_ids, nids * sizeof(uint64_t));
+        if (ids == NULL) {
+            pthread_mutex_unlock(&csync_pool_ids_lock);
+            return ENOMEM;
+        }
+        memset(ids + csync_pool_nids, 0, (nids - csync_pool_nids) * sizeof(uint64_t));
+        csync_pool_ids = ids;
+        csync_pool_nids = nids;
+    }
+    pool->id = id;
+    pool->gen = csync_pool_next_gen++;
+    csync_pool_ids[id] = pool->gen;
+    pthread_mutex_unlock(&csync_pool_ids_lock);
+    return 0;
+}
+
+/*!
+  * @brief frees the id of a pool that is being destroyed
+  * @details once this returns no exiting thread touches the pool or its caches anymore
+*/
+static void csync_pool_id_free(csync_pool_t *pool) {
+    pthread_mutex_lock(&csync_pool_ids_lock);
+    csync_pool_ids[pool->id] = 0;
+    pthread_mutex_unlock(&csync_pool_ids_lock);
+    // threads that pinned the pool before its id was freed are still flushing into it
+    while (atomic_load_explicit(&pool->exiting, memory_order_acquire) != 0) {
+        sched_yield();
+    }
+}
+
+/*!
+  * @brief returns the calling thread's table of caches, grown so it has a slot for the pool
+  * @return Success: the calling thread's table
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+static csync_pool_table_t *csync_pool_table(csync_pool_t *pool) {
+    csync_pool_table_t *table = pthread_getspecific(csync_pool_key);
+    if (table != NULL && pool->id < table->size) {
+        return table;
+    }
+    unsigned int size = table != NULL ? table->size : 0;
+    unsigned int grown_size = size ? size * 2 : 16;
+    while (grown_size <= pool->id) {
+        grown_size *= 2;
+    }
+    csync_pool_table_t *grown = realloc(table, sizeof(csync_pool_table_t) + grown_size * sizeof(csync_pool_slot_t));
+    if (grown == NULL) {
+        return NULL;
+    }
+    memset(&grown->slots[size], 0, (grown_size - size) * sizeof(csync_pool_slot_t));
+    grown->size = grown_size;
+    // can only fail the first time a thread sets the key, when there is no old table to lose
+    if (pthread_setspecific(csync_pool_key, grown) != 0) {
+        free(grown);
+        return NULL;
+    }
+    return grown;
+}
+
+/*!
+  * @brief returns the calling thread's cache, adopting an abandoned one or creating it on first use
+  * @return Success: the calling thread's cache
+  * @return Failure: NULL in which case the shared tier must be used directly
+*/
+static csync_pool_local_t *csync_pool_local(csync_pool_t *pool) {
+    csync_pool_local_t *local = csync_pool_local_peek(pool);
+    if (local != NULL) {
+        unsigned int epoch = atomic_load_explicit(&pool->epoch, memory_order_relaxed);
+        if (local->epoch != epoch) {
+            // the pool was trimmed, give the shared tier a chance to age our objects
+            csync_pool_local_flush(pool, local);
+            local->epoch = epoch;
+        }
+        return local;
+    }
+    csync_pool_table_t *table = csync_pool_table(pool);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    csync_pool_lock(pool);
+    local = pool->locals;
+    while (local != NULL && !atomic_load_explicit(&local->abandoned, memory_order_relaxed)) {
+        local = local->next;
+    }
+    if (local != NULL) {
+        atomic_store_explicit(&local->abandoned, 0, memory_order_relaxed);
+    }
+    csync_lock_unlock(&pool->mutex);
+
+    if (local == NULL) {
+        local = calloc(1, sizeof(csync_pool_local_t));
+        if (local == NULL) {
+            return NULL;
+        }
+        local->pool = pool;
+        atomic_init(&local->remote, NULL);
+        atomic_init(&local->abandoned, 0);
+
+        csync_pool_lock(pool);
+        local->next = pool->locals;
+        if (pool->locals != NULL) {
+            pool->locals->prev = local;
+        }
+        pool->locals = local;
+        csync_lock_unlock(&pool->mutex);
+    }
+    local->epoch = atomic_load_explicit(&pool->epoch, memory_order_relaxed);
+    table->slots[pool->id].local = local;
+    table->slots[pool->id].gen = pool->gen;
+    return local;
+}
+
 /*!
   * @brief intializes a pool with size available slots for objects
   * @details allows reuse objects created by alloc_fn to reduce memory allocations
@@ -21,36 +1056,196 @@
   * @param size this is not a max limit, and will be doubled whenever we have allocated size amount
   * @param alloc_fn a function that when called will return a new chunk of memory
   * @param free_fn a function that is used to free up the objects returned by alloc_fn
+  * @note alloc_fn is never called while holding the mutex, so an expensive constructor doesn't block other threads
+  * @note alloc_fn may be NULL, in which case csync_pool_get returns NULL if no object is stored
 */
 csync_pool_t *csync_pool_new(unsigned int size, csync_pool_alloc alloc_fn, csync_pool_free free_fn) {
+    return csync_pool_new_ex(size, alloc_fn, free_fn, CSYNC_POOL_DEFAULT_FLAGS);
+}
+
+/*!
+  * @brief intializes a pool like csync_pool_new using the given implementation
+  * @param size the initial number of slots (or nodes in lock-free mode) in the shared tier
+  * @param alloc_fn a function that when called will return a new chunk of memory
+  * @param free_fn a function that is used to free up the objects returned by alloc_fn
+  * @param flags a bitwise or of csync_pool_flags_t values
+  * @note with CSYNC_POOL_LOCKFREE getting and putting objects never blocks on another thread
+  * @note only growing the node storage, which happens at most CSYNC_POOL_MAX_CHUNKS times, takes the mutex
+*/
+csync_pool_t *csync_pool_new_ex(unsigned int size, csync_pool_alloc alloc_fn, csync_pool_free free_fn, int flags) {
     csync_pool_t *pool = calloc(1, sizeof(csync_pool_t));
     if (pool == NULL) {
         return NULL;
     }
-    pool->items = calloc(1, size);
+    if (size == 0) {
+        size = 1;
+    }
+    if (flags & CSYNC_POOL_LOCKFREE) {
+        // node chunks are indexed by power of two boundaries
+        unsigned int base = 16;
+        while (base < size && base < (1u << 16)) {
+            base *= 2;
+        }
+        size = base;
+    } else {
+        pool->items = calloc(size, sizeof(void *));
+        if (pool->items == NULL) {
+            free(pool);
+            return NULL;
+        }
+    }
+    if (csync_once_try(&csync_pool_key_once, csync_pool_key_create, NULL) != 0 || csync_pool_id_new(pool) != 0) {
+        free(pool->items);
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->exiting, 0);
     pool->size = size;
     pool->count = 0;
     pool->alloc_fn = alloc_fn;
     pool->free_fn = free_fn;
-    pthread_mutex_init(&pool->mutex, NULL);
+    pool->locals = NULL;
+    pool->flags = flags;
+    pool->obj_size = 0;
+    pool->slabs = NULL;
+    pool->decommitted = NULL;
+    pool->carve.slab = NULL;
+    pool->carve.next = NULL;
+    pool->carve.end = NULL;
+    pool->free_list = NULL;
+    pool->victim = NULL;
+    pool->victim_count = 0;
+    pool->victim_list = NULL;
+    atomic_init(&pool->victim_head, 0);
+    atomic_init(&pool->epoch, 0);
+    pool->ticker_running = 0;
+    pool->resizes = 0;
+    pool->cap = 0;
+    pool->local_cap = CSYNC_POOL_LOCAL_SIZE;
+    atomic_init(&pool->shared_idle, 0);
+    atomic_init(&pool->shared_peak_idle, 0);
+    pool->nchunks = 0;
+    atomic_init(&pool->head, 0);
+    atomic_init(&pool->free_nodes, 0);
+    for (unsigned int i = 0; i < CSYNC_POOL_MAX_CHUNKS; i++) {
+        atomic_init(&pool->chunks[i], NULL);
+    }
+    csync_lock_init(&pool->mutex);
+    csync_event_new(&pool->ticker_stop);
+    // the ticker sleeps for whole intervals, spinning first would only waste cpu time
+    csync_event_set_spins(&pool->ticker_stop, 0);
+    return pool;
+}
+
+/*!
+  * @brief limits the number of objects a pool holds on to
+  * @details at most cap objects are stored in the shared tier, and every thread caches at most
+  * @details min(cap, CSYNC_POOL_LOCAL_SIZE) objects, objects put beyond that are passed to free_fn
+  * @param pool an initialized instance of csync_pool_t
+  * @param cap the maximum number of objects in the shared tier, 0 removes the limit
+  * @note has no effect on fixed size pools, whose objects can't be freed on their own
+  * @warning must be called before the pool is used by other threads
+*/
+void csync_pool_set_cap(csync_pool_t *pool, unsigned int cap) {
+    if (pool->obj_size != 0) {
+        return;
+    }
+    pool->cap = cap;
+    pool->local_cap = cap != 0 && cap < CSYNC_POOL_LOCAL_SIZE ? cap : CSYNC_POOL_LOCAL_SIZE;
+}
+
+/*!
+  * @brief intializes a pool of fixed size objects carved out of contiguous slabs
+  * @details instead of calling an alloc_fn for every miss, slabs of at least CSYNC_POOL_SLAB_SIZE
+  * @details bytes are allocated and objects are handed out from them in order, and destroying
+  * @details the pool frees whole slabs, so there is no free_fn and objects are never freed on their own
+  * @details objects are not zeroized when reused, and only the memory of never used objects is zeroed
+  * @details while an object is stored in the shared tier its first sizeof(void *) bytes hold the free list
+  * @details with CSYNC_POOL_HUGEPAGES slabs are prefaulted arenas mapped with mmap and advised to use
+  * @details transparent huge pages, falling back to the heap if they can't be mapped, and trimming an arena
+  * @details gives its memory back with MADV_DONTNEED while keeping the mapping around to carve from again
+  * @param obj_size the size of the objects, at least sizeof(void *) is used
+  * @param align the alignment of the objects, must be a power of two or 0 for the alignment of max_align_t
+  * @param size the minimum number of objects per slab
+  * @param flags a bitwise or of csync_pool_flags_t values
+  * @return Success: an initialized pool
+  * @return Failure: NULL if memory couldn't be allocated or align isn't a power of two
+*/
+csync_pool_t *csync_pool_new_fixed(size_t obj_size, size_t align, unsigned int size, int flags) {
+    if (align == 0) {
+        align = _Alignof(max_align_t);
+    }
+    if ((align & (align - 1)) != 0) {
+        return NULL;
+    }
+    // free objects store the free list pointer in their first bytes
+    if (align < _Alignof(void *)) {
+        align = _Alignof(void *);
+    }
+    if (obj_size < sizeof(void *)) {
+        obj_size = sizeof(void *);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    obj_size = (obj_size + align - 1) & ~(align - 1);
+    size_t obj_offset = (sizeof(csync_pool_slab_t) + align - 1) & ~(align - 1);
+    if (obj_size > (SIZE_MAX / 4 - obj_offset) / size) {
+        return NULL;
+    }
+    size_t slab_size = flags & CSYNC_POOL_HUGEPAGES ? CSYNC_POOL_HUGEPAGE_SIZE : CSYNC_POOL_SLAB_SIZE;
+    while (slab_size < obj_offset + obj_size * size) {
+        slab_size *= 2;
+    }
+
+    // the items array is never used, the objects link themselves into the free list instead
+    csync_pool_t *pool = csync_pool_new_ex(flags & CSYNC_POOL_LOCKFREE ? size : 1, NULL, NULL, flags);
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->obj_size = obj_size;
+    pool->obj_offset = obj_offset;
+    pool->slab_size = slab_size;
     return pool;
 }
 
 /*!
   * @brief returns an existing object, creating one from scratch if none are currently stored
+  * @details objects are taken from the calling thread's cache first, then from the shared tier
   * @warning after you are done using the object you need to put it back into the pool
 */
 void *csync_pool_get(csync_pool_t *pool) {
-    pthread_mutex_lock(&pool->mutex);
-    if (pool->count > 0) {
-        // since array start at 0, minus 1 from count
-        void *item = pool->items[pool->count - 1];
-        pool->count -= 1;
-        pthread_mutex_unlock(&pool->mutex);
-        return item;
-    }
-    void *item = pool->alloc_fn();
-    pthread_mutex_unlock(&pool->mutex);
+    csync_pool_local_t *local = csync_pool_local(pool);
+    if (local != NULL) {
+        if (local->count == 0 && pool->obj_size != 0) {
+            // objects returned by other threads don't need the shared tier
+            local->count = csync_pool_returned_pop(local, local->items, CSYNC_POOL_LOCAL_SIZE / 2);
+        }
+        if (local->count == 0) {
+            // refill the cache with up to half of its capacity
+            local->count = csync_pool_shared_pop(pool, local->items, (pool->local_cap + 1) / 2);
+        }
+        if (local->count == 0 && pool->obj_size != 0) {
+            local->count = csync_pool_slab_carve(pool, local, local->items, CSYNC_POOL_LOCAL_SIZE / 2);
+            CSYNC_POOL_COUNT(pool, local, misses, local->count);
+        }
+        if (local->count > 0) {
+            CSYNC_POOL_COUNT(pool, local, gets, 1);
+            local->count -= 1;
+            return local->items[local->count];
+        }
+    } else {
+        void *item;
+        if (csync_pool_shared_pop(pool, &item, 1) == 1) {
+            CSYNC_POOL_COUNT(pool, local, gets, 1);
+            return item;
+        }
+    }
+    void *item = csync_pool_alloc_object(pool, local);
+    if (item != NULL) {
+        CSYNC_POOL_COUNT(pool, local, misses, 1);
+        CSYNC_POOL_COUNT(pool, local, gets, 1);
+    }
     return item;
 }
 
@@ -59,38 +1254,313 @@ void *csync_pool_get(csync_pool_t *pool) {
   * @warning do not use the pointer after you have returned it to the pool
   * @param pool an initializedd instance of csync_pool_t
   * @param item the object to put back into the pool
+  * @note objects are put into the calling thread's cache, and only spill into the shared tier once it is full
   * @note it will resize the items array if needed
 */
 void csync_pool_put(csync_pool_t *pool, void *item) {
-    pthread_mutex_lock(&pool->mutex);
-    if (pool->count >= pool->size) {
-        // increase size by 2
-        pool->size *= 2;
-        // reallocate the memory
-        pool->items = realloc(pool->items, pool->size);
-        if (pool->items == NULL) {
-            // todo: gracefully handle
-            exit(1);
+    csync_pool_local_t *local = csync_pool_local(pool);
+    CSYNC_POOL_COUNT(pool, local, puts, 1);
+    csync_pool_local_t *owner = csync_pool_remote_owner(pool, local, item);
+    if (owner != NULL) {
+        // hand the object back to the thread that carved it
+        csync_pool_remote_push(owner, item, item);
+        return;
+    }
+    if (local == NULL) {
+        csync_pool_shared_push(pool, &item, 1);
+        return;
+    }
+    if (local->count >= pool->local_cap) {
+        // spill the oldest half of the cache, keeping the most recently used objects local
+        unsigned int num = (pool->local_cap + 1) / 2;
+        csync_pool_shared_push(pool, local->items, num);
+        local->count -= num;
+        memmove(local->items, local->items + num, local->count * sizeof(void *));
+    }
+    local->items[local->count] = item;
+    local->count += 1;
+}
+
+/*!
+  * @brief takes num objects out of the pool at once, creating the ones that are missing
+  * @details the objects are taken from the calling thread's cache, and then from the shared
+  * @details tier locking it at most once, and only after that are new objects created
+  * @param pool an initialized instance of csync_pool_t
+  * @param items an array of at least num elements the objects are stored in
+  * @param num the number of objects to get
+  * @note like csync_pool_get, elements are NULL if an object couldn't be created
+*/
+void csync_pool_get_n(csync_pool_t *pool, void **items, unsigned int num) {
+    unsigned int count = 0;
+    csync_pool_local_t *local = csync_pool_local(pool);
+    if (local != NULL) {
+        count = local->count < num ? local->count : num;
+        local->count -= count;
+        memcpy(items, local->items + local->count, count * sizeof(void *));
+        if (pool->obj_size != 0) {
+            count += csync_pool_returned_pop(local, items + count, num - count);
         }
+    }
+    if (count < num) {
+        count += csync_pool_shared_pop(pool, items + count, num - count);
+    }
+    unsigned int reused = count;
+    if (pool->obj_size != 0) {
+        while (count < num) {
+            unsigned int carved = csync_pool_slab_carve(pool, local, items + count, num - count);
+            if (carved == 0) {
+                break;
+            }
+            count += carved;
+        }
+    }
+    unsigned int created = count - reused;
+    for (; count < num; count++) {
+        items[count] = csync_pool_alloc_object(pool, local);
+        if (items[count] != NULL) {
+            created += 1;
+        }
+    }
+    CSYNC_POOL_COUNT(pool, local, misses, created);
+    CSYNC_POOL_COUNT(pool, local, gets, reused + created);
+}
 
+/*!
+  * @brief returns num objects back into the pool at once
+  * @details the objects fill up the calling thread's cache first, the remaining ones are
+  * @details stored in the shared tier locking it at most once
+  * @param pool an initialized instance of csync_pool_t
+  * @param items the objects to put back into the pool
+  * @param num the number of objects in items
+  * @warning do not use the pointers after you have returned them to the pool
+  * @note items is used as scratch space, so its contents are undefined afterwards
+*/
+void csync_pool_put_n(csync_pool_t *pool, void **items, unsigned int num) {
+    unsigned int count = 0;
+    csync_pool_local_t *local = csync_pool_local(pool);
+    CSYNC_POOL_COUNT(pool, local, puts, num);
+    if (pool->obj_size != 0) {
+        // hand objects carved by other threads back, keeping the rest at the start of items
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < num; i++) {
+            csync_pool_local_t *owner = csync_pool_remote_owner(pool, local, items[i]);
+            if (owner == NULL) {
+                items[kept] = items[i];
+                kept += 1;
+                continue;
+            }
+            // objects with the same owner are pushed at once
+            unsigned int first = i;
+            while (i + 1 < num && csync_pool_remote_owner(pool, local, items[i + 1]) == owner) {
+                *(void **)items[i] = items[i + 1];
+                i += 1;
+            }
+            csync_pool_remote_push(owner, items[first], items[i]);
+        }
+        num = kept;
+    }
+    if (local != NULL) {
+        unsigned int room = local->count < pool->local_cap ? pool->local_cap - local->count : 0;
+        count = room < num ? room : num;
+        memcpy(local->items + local->count, items, count * sizeof(void *));
+        local->count += count;
+    }
+    if (count < num) {
+        csync_pool_shared_push(pool, items + count, num - count);
+    }
+}
+
+/*!
+  * @brief arguments of a csync_pool_prewarm worker
+*/
+typedef struct csync_pool_prewarm_args {
+    csync_pool_t *pool;
+    unsigned int num;
+    unsigned int created;
+} csync_pool_prewarm_args_t;
+
+/*!
+  * @brief creates args->num objects and stores them in the shared tier in batches
+*/
+static void *csync_pool_prewarm_fn(void *data) {
+    csync_pool_prewarm_args_t *args = (csync_pool_prewarm_args_t *)data;
+    csync_pool_t *pool = args->pool;
+    void *items[CSYNC_POOL_LOCAL_SIZE];
+
+    while (args->created < args->num) {
+        unsigned int num = args->num - args->created < CSYNC_POOL_LOCAL_SIZE ? args->num - args->created : CSYNC_POOL_LOCAL_SIZE;
+        unsigned int count = 0;
+        if (pool->obj_size != 0) {
+            count = csync_pool_slab_carve(pool, NULL, items, num);
+        } else if (pool->alloc_fn != NULL) {
+            while (count < num && (items[count] = pool->alloc_fn()) != NULL) {
+                count += 1;
+            }
+        }
+        CSYNC_POOL_COUNT(pool, (csync_pool_local_t *)NULL, misses, count);
+        csync_pool_shared_push(pool, items, count);
+        args->created += count;
+        // a slab may run out before num objects are carved, so only a failed allocation stops us
+        if (count == 0 || (pool->obj_size == 0 && count < num)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*!
+  * @brief creates num objects using nthreads threads and stores them in the pool
+  * @details used to pay for creating objects at startup instead of during the first burst of traffic
+  * @details the objects are stored in the shared tier, and are subject to csync_pool_trim like any other object
+  * @param pool an initialized instance of csync_pool_t
+  * @param num the number of objects to create
+  * @param nthreads the number of threads to create them with, 0 or 1 uses the calling thread
+  * @return the number of objects that were created, less than num if creating an object failed
+*/
+unsigned int csync_pool_prewarm(csync_pool_t *pool, unsigned int num, unsigned int nthreads) {
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    if (nthreads > num) {
+        nthreads = num > 0 ? num : 1;
+    }
+    csync_pool_prewarm_args_t *args = calloc(nthreads, sizeof(csync_pool_prewarm_args_t));
+    pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+    if (args == NULL || threads == NULL) {
+        free(args);
+        free(threads);
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < nthreads; i++) {
+        args[i].pool = pool;
+        args[i].num = num / nthreads + (i < num % nthreads ? 1 : 0);
+        args[i].created = 0;
+    }
+    // the calling thread takes the first share instead of sitting idle
+    for (unsigned int i = 1; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, csync_pool_prewarm_fn, &args[i]) != 0) {
+            csync_pool_prewarm_fn(&args[i]);
+            args[i].pool = NULL;
+        }
+    }
+    csync_pool_prewarm_fn(&args[0]);
+
+    unsigned int created = args[0].created;
+    for (unsigned int i = 1; i < nthreads; i++) {
+        if (args[i].pool != NULL) {
+            pthread_join(threads[i], NULL);
+        }
+        created += args[i].created;
+    }
+
+    free(args);
+    free(threads);
+    return created;
+}
+
+#if CSYNC_POOL_STATS
+/*!
+  * @brief adds the values of a set of counters to a snapshot
+*/
+static void csync_pool_stats_add(csync_pool_stats_t *stats, csync_pool_counters_t *counters) {
+    stats->gets += atomic_load_explicit(&counters->gets, memory_order_relaxed);
+    stats->puts += atomic_load_explicit(&counters->puts, memory_order_relaxed);
+    stats->misses += atomic_load_explicit(&counters->misses, memory_order_relaxed);
+    stats->frees += atomic_load_explicit(&counters->frees, memory_order_relaxed);
+    stats->lock_wait_ns += atomic_load_explicit(&counters->lock_wait_ns, memory_order_relaxed);
+}
+#endif
+
+/*!
+  * @brief takes a snapshot of the statistics of a pool
+  * @details the per-thread counters of all threads using the pool are summed up, which takes the mutex
+  * @param pool an initialized instance of csync_pool_t
+  * @param stats the snapshot is stored here
+  * @note reports zeros when built with CSYNC_POOL_STATS set to 0
+*/
+void csync_pool_stats(csync_pool_t *pool, csync_pool_stats_t *stats) {
+    memset(stats, 0, sizeof(csync_pool_stats_t));
+#if CSYNC_POOL_STATS
+    csync_pool_lock(pool);
+    csync_pool_stats_add(stats, &pool->stats);
+    for (csync_pool_local_t *local = pool->locals; local != NULL; local = local->next) {
+        csync_pool_stats_add(stats, &local->stats);
     }
-    pool->items[pool->count] = item;
-    pool->count += 1;
-    pthread_mutex_unlock(&pool->mutex);
+    stats->resizes = pool->resizes;
+    csync_lock_unlock(&pool->mutex);
+
+    // every created object is either borrowed, given up on or stored in the pool
+    uint64_t gone = stats->gets + stats->frees;
+    stats->idle = stats->misses + stats->puts > gone ? stats->misses + stats->puts - gone : 0;
+    stats->shared_idle = atomic_load_explicit(&pool->shared_idle, memory_order_relaxed);
+    stats->shared_peak_idle = atomic_load_explicit(&pool->shared_peak_idle, memory_order_relaxed);
+#else
+    (void)pool;
+#endif
 }
 
 /*!
   * @brief used to completely destroy the pool and all allocated objects
+  * @details this includes the objects still cached by threads that are alive
+  * @details and stops the ticker if it is running
   * @warning do not use while any objects are borrowed from the pool
+  * @warning do not use while other threads are still using the pool
 */
 void csync_pool_destroy(csync_pool_t *pool) {
-  pthread_mutex_lock(&pool->mutex);
+    csync_pool_ticker_stop(pool);
+
+    // freeing the id first guarantees csync_pool_local_exit wont run anymore
+    csync_pool_id_free(pool);
 
-  for (unsigned int i = 0; i < pool->count; i++) {
-    pool->free_fn(pool->items[i]);
-  }
+    csync_pool_lock(pool);
+
+    csync_pool_local_t *local = pool->locals;
+    while (local != NULL) {
+        csync_pool_local_t *next = local->next;
+        for (unsigned int i = 0; i < local->count; i++) {
+            csync_pool_free_object(pool, local->items[i]);
+        }
+        free(local);
+        local = next;
+    }
+
+    for (unsigned int i = 0; i < pool->count; i++) {
+        csync_pool_free_object(pool, pool->items[i]);
+    }
+    for (unsigned int i = 0; i < pool->victim_count; i++) {
+        csync_pool_free_object(pool, pool->victim[i]);
+    }
+
+    uint32_t index;
+    while ((index = csync_pool_stack_pop(pool, &pool->head)) != 0) {
+        csync_pool_free_object(pool, csync_pool_node(pool, index)->item);
+    }
+    while ((index = csync_pool_stack_pop(pool, &pool->victim_head)) != 0) {
+        csync_pool_free_object(pool, csync_pool_node(pool, index)->item);
+    }
+    for (unsigned int i = 0; i < pool->nchunks; i++) {
+        free(atomic_load_explicit(&pool->chunks[i], memory_order_relaxed));
+    }
+
+    // objects of fixed size pools are freed along with their slabs
+    csync_pool_slab_t *slab = pool->slabs;
+    while (slab != NULL) {
+        csync_pool_slab_t *next = slab->next;
+        csync_pool_slab_free(pool, slab);
+        slab = next;
+    }
+    slab = pool->decommitted;
+    while (slab != NULL) {
+        csync_pool_slab_t *next = slab->next;
+        csync_pool_slab_free(pool, slab);
+        slab = next;
+    }
 
-  pthread_mutex_destroy(&pool->mutex);
+    csync_lock_unlock(&pool->mutex);
+    csync_lock_destroy(&pool->mutex);
 
-  free(pool);
+    free(pool->items);
+    free(pool->victim);
+    free(pool);
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*!
+  * @file rwmutex.h
+  * @brief a reader/writer lock whose readers don't share a cache line
+  * @details readers announce themselves in a slot of the cpu they run on, so read locks taken on
+  * @details different cpus don't contend at all, while a writer has to look at every slot
+*/
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "futex.h"
+#include "rwmutex.h"
+
+/*!
+  * @brief returns a new unlocked reader/writer lock with a reader slot for every configured cpu
+  * @return Success: an initialized instance of csync_rwmutex_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_rwmutex_t *csync_rwmutex_new(void) {
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    csync_rwmutex_t *rw = calloc(1, sizeof(csync_rwmutex_t));
+    if (rw == NULL) {
+        return NULL;
+    }
+    rw->nslots = ncpus > 0 ? (unsigned int)ncpus : 1;
+    rw->slots = aligned_alloc(CSYNC_CACHE_LINE, rw->nslots * sizeof(csync_rwmutex_slot_t));
+    if (rw->slots == NULL) {
+        free(rw);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < rw->nslots; i++) {
+        atomic_init(&rw->slots[i].readers, 0);
+    }
+    atomic_init(&rw->writer, CSYNC_RWMUTEX_FREE);
+    atomic_init(&rw->drain, 0);
+    csync_mutex_new(&rw->writers);
+    return rw;
+}
+
+/*!
+  * @brief returns the reader slot of the cpu the calling thread is running on
+*/
+static csync_rwmutex_slot_t *csync_rwmutex_slot(csync_rwmutex_t *rw) {
+    int cpu = sched_getcpu();
+    return &rw->slots[cpu > 0 ? (unsigned int)cpu % rw->nslots : 0];
+}
+
+/*!
+  * @brief removes a reader from a slot, waking the writer if one is waiting for the readers to leave
+*/
+static void csync_rwmutex_leave(csync_rwmutex_t *rw, csync_rwmutex_slot_t *slot) {
+    atomic_fetch_sub_explicit(&slot->readers, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&rw->writer, memory_order_seq_cst) != CSYNC_RWMUTEX_FREE) {
+        atomic_fetch_add_explicit(&rw->drain, 1, memory_order_release);
+        csync_futex_wake(&rw->drain, 1);
+    }
+}
+
+/*!
+  * @brief waits until no writer holds or waits for the lock, spinning for a while before parking
+*/
+static void csync_rwmutex_wait_writer(csync_rwmutex_t *rw) {
+    for (unsigned int i = 0; i < CSYNC_RWMUTEX_SPINS; i++) {
+        if (atomic_load_explicit(&rw->writer, memory_order_relaxed) == CSYNC_RWMUTEX_FREE) {
+            return;
+        }
+        CSYNC_CPU_RELAX();
+    }
+    uint32_t writer = atomic_load_explicit(&rw->writer, memory_order_relaxed);
+    while (writer != CSYNC_RWMUTEX_FREE) {
+        // tell the writer to wake us when it unlocks
+        if (writer == CSYNC_RWMUTEX_WRITER && !atomic_compare_exchange_weak_explicit(&rw->writer, &writer, CSYNC_RWMUTEX_PARKED, memory_order_relaxed, memory_order_relaxed)) {
+            continue;
+        }
+        csync_futex_wait(&rw->writer, CSYNC_RWMUTEX_PARKED);
+        writer = atomic_load_explicit(&rw->writer, memory_order_relaxed);
+    }
+}
+
+/*!
+  * @brief locks for reading, blocking while a writer holds or waits for the lock
+  * @details without a writer this is an atomic increment of the slot of the current cpu and a load
+*/
+void csync_rwmutex_rlock(csync_rwmutex_t *rw) {
+    for (;;) {
+        csync_rwmutex_slot_t *slot = csync_rwmutex_slot(rw);
+        atomic_fetch_add_explicit(&slot->readers, 1, memory_order_seq_cst);
+        if (atomic_load_explicit(&rw->writer, memory_order_seq_cst) == CSYNC_RWMUTEX_FREE) {
+            return;
+        }
+        // the writer may already be waiting for the slots to drain, so back out instead of holding it up
+        csync_rwmutex_leave(rw, slot);
+        csync_rwmutex_wait_writer(rw);
+    }
+}
+
+/*!
+  * @brief undoes a single csync_rwmutex_rlock call, which may have been made on another cpu
+*/
+void csync_rwmutex_runlock(csync_rwmutex_t *rw) {
+    csync_rwmutex_leave(rw, csync_rwmutex_slot(rw));
+}
+
+/*!
+  * @brief returns the number of readers holding the lock
+  * @details every reader that locked before the writer word was set is seen with its increment, and
+  * @details a decrement is never seen without its increment, so 0 means all of them have left
+*/
+static int64_t csync_rwmutex_readers(csync_rwmutex_t *rw) {
+    int64_t readers = 0;
+    for (unsigned int i = 0; i < rw->nslots; i++) {
+        readers += atomic_load_explicit(&rw->slots[i].readers, memory_order_seq_cst);
+    }
+    return readers;
+}
+
+/*!
+  * @brief locks for writing, blocking until all readers and other writers are gone
+  * @details new readers are held back as soon as this is called
+*/
+void csync_rwmutex_lock(csync_rwmutex_t *rw) {
+    csync_mutex_lock(&rw->writers);
+    atomic_store_explicit(&rw->writer, CSYNC_RWMUTEX_WRITER, memory_order_seq_cst);
+    for (;;) {
+        uint32_t drain = atomic_load_explicit(&rw->drain, memory_order_acquire);
+        if (csync_rwmutex_readers(rw) == 0) {
+            return;
+        }
+        csync_futex_wait(&rw->drain, drain);
+    }
+}
+
+/*!
+  * @brief unlocks a lock held for writing, and wakes the readers that waited for it
+*/
+void csync_rwmutex_unlock(csync_rwmutex_t *rw) {
+    if (atomic_exchange_explicit(&rw->writer, CSYNC_RWMUTEX_FREE, memory_order_release) == CSYNC_RWMUTEX_PARKED) {
+        csync_futex_wake(&rw->writer, INT32_MAX);
+    }
+    csync_mutex_unlock(&rw->writers);
+}
+
+/*!
+  * @brief frees the lock and its reader slots
+  * @warning do not use while the lock is held or other threads are still using it
+*/
+void csync_rwmutex_destroy(csync_rwmutex_t *rw) {
+    free(rw->slots);
+    free(rw);
+}
\ No newline at end of file
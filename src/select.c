@@ -0,0 +1,196 @@
+/*!
+  * @file select.h
+  * @brief waits for the first of several conditions and wait groups to become ready
+  * @details is roughly equivalent to a Golang select statement, the calling thread adds itself to every source
+  * @details and sleeps on a single futex word, which the first source to fire sets to its index
+*/
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cond.h"
+#include "futex.h"
+#include "select.h"
+#include "wait_group.h"
+#include "waitlist.h"
+
+/*!
+  * @brief returns a random number from a per thread xorshift generator, only used to order cases
+*/
+static uint32_t csync_select_random(void) {
+    static _Thread_local uint32_t x;
+    if (x == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        x = ((uint32_t)now.tv_nsec ^ (uint32_t)(uintptr_t)&now) | 1;
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/*!
+  * @brief returns whether the case is ready without registering on it
+*/
+static int csync_select_ready(const csync_select_case_t *c) {
+    if (c->kind == CSYNC_SELECT_WAIT_GROUP) {
+        return csync_wait_group_count(c->wg) == 0;
+    }
+    if (c->pred == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&c->cond->mutex);
+    int ready = c->pred(c->arg);
+    pthread_mutex_unlock(&c->cond->mutex);
+    return ready;
+}
+
+/*!
+  * @brief adds node to the source of the case
+  * @return 1 if the case is already ready, in which case the node isn't added
+*/
+static int csync_select_add(const csync_select_case_t *c, csync_waitlist_node_t *node) {
+    if (c->kind == CSYNC_SELECT_WAIT_GROUP) {
+        return csync_wait_group_select_add(c->wg, node);
+    }
+    return csync_cond_select_add(c->cond, node, c->pred, c->arg);
+}
+
+static void csync_select_remove(const csync_select_case_t *c, csync_waitlist_node_t *node) {
+    if (c->kind == CSYNC_SELECT_WAIT_GROUP) {
+        csync_wait_group_select_remove(c->wg, node);
+    } else {
+        csync_cond_select_remove(c->cond, node);
+    }
+}
+
+/*!
+  * @brief returns the index of the first ready case in the order of nodes, or num if none is
+*/
+static size_t csync_select_scan(const csync_select_case_t *cases, const csync_waitlist_node_t *nodes, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        if (csync_select_ready(&cases[nodes[i].id])) {
+            return nodes[i].id;
+        }
+    }
+    return num;
+}
+
+/*!
+  * @brief waits until one of the cases is ready, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details the cases are checked in a random order, so when several are ready every one of them gets picked
+  * @details eventually, if none is the thread registers on all of them and sleeps until the first one fires
+  * @details like csync_cond_wait_until, the predicate of a notified condition is checked again before
+  * @details returning, and every case is checked one last time once abs passed
+  * @param cases the sources to wait on, a source may appear in several cases
+  * @param num the number of cases
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @param fired set to the index of the case that was ready
+  * @return Success: 0
+  * @return Failure: ETIMEDOUT if no case was ready at abs, EINVAL if num is 0, ENOMEM if memory couldn't be allocated
+  * @warning like csync_wait_group_wait, a wait group may only be reused once every select on it returned
+*/
+int csync_select(const csync_select_case_t *cases, size_t num, const struct timespec *abs, size_t *fired) {
+    if (num == 0 || num >= UINT32_MAX) {
+        return EINVAL;
+    }
+    csync_waitlist_node_t stack[CSYNC_SELECT_STACK_CASES];
+    csync_waitlist_node_t *nodes = stack;
+    if (num > CSYNC_SELECT_STACK_CASES) {
+        nodes = malloc(num * sizeof(csync_waitlist_node_t));
+        if (nodes == NULL) {
+            return ENOMEM;
+        }
+    }
+    // nodes are kept in a random order, which is the order cases are checked and registered in
+    _Atomic uint32_t word;
+    for (size_t i = 0; i < num; i++) {
+        size_t j = csync_select_random() % (i + 1);
+        nodes[i].id = (uint32_t)i;
+        uint32_t id = nodes[j].id;
+        nodes[j].id = nodes[i].id;
+        nodes[i].id = id;
+        nodes[i].fired = &word;
+    }
+
+    int rc = 0;
+    size_t ready = csync_select_scan(cases, nodes, num);
+    while (ready == num) {
+        atomic_store_explicit(&word, 0, memory_order_relaxed);
+        size_t registered = 0;
+        for (; registered < num; registered++) {
+            if (csync_select_add(&cases[nodes[registered].id], &nodes[registered])) {
+                ready = nodes[registered].id;
+                break;
+            }
+        }
+
+        int notified = 0;
+        if (ready == num) {
+            uint32_t value;
+            while ((value = atomic_load_explicit(&word, memory_order_acquire)) == 0) {
+                if (csync_futex_wait_until(&word, 0, abs) == ETIMEDOUT) {
+                    rc = ETIMEDOUT;
+                    break;
+                }
+            }
+        }
+        // once removed no source touches the nodes or word anymore, so a fire that raced with the timeout is seen below
+        for (size_t i = 0; i < registered; i++) {
+            csync_select_remove(&cases[nodes[i].id], &nodes[i]);
+        }
+        if (ready == num) {
+            uint32_t value = atomic_load_explicit(&word, memory_order_acquire);
+            if (value != 0) {
+                ready = value - 1;
+                notified = 1;
+                rc = 0;
+            }
+        }
+
+        // a notified condition only means its predicate may hold
+        if (notified && cases[ready].kind == CSYNC_SELECT_COND && cases[ready].pred != NULL && !csync_select_ready(&cases[ready])) {
+            ready = csync_select_scan(cases, nodes, num);
+            continue;
+        }
+        if (rc == ETIMEDOUT) {
+            ready = csync_select_scan(cases, nodes, num);
+            if (ready == num) {
+                break;
+            }
+            rc = 0;
+        }
+    }
+    if (nodes != stack) {
+        free(nodes);
+    }
+    if (rc == 0) {
+        *fired = ready;
+    }
+    return rc;
+}
+
+/*!
+  * @brief like csync_select, but gives up once ns nanoseconds have passed
+  * @param cases the sources to wait on
+  * @param num the number of cases
+  * @param ns the maximum time to wait for in nanoseconds
+  * @param fired set to the index of the case that was ready
+  * @return Success: 0
+  * @return Failure: ETIMEDOUT if no case was ready in time, EINVAL if num is 0, ENOMEM like csync_select
+*/
+int csync_select_timeout(const csync_select_case_t *cases, size_t num, uint64_t ns, size_t *fired) {
+    struct timespec abs;
+    clock_gettime(CLOCK_MONOTONIC, &abs);
+    abs.tv_sec += (time_t)(ns / 1000000000);
+    abs.tv_nsec += (long)(ns % 1000000000);
+    if (abs.tv_nsec >= 1000000000) {
+        abs.tv_sec += 1;
+        abs.tv_nsec -= 1000000000;
+    }
+    return csync_select(cases, num, &abs, fired);
+}
\ No newline at end of file
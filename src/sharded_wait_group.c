@@ -0,0 +1,214 @@
+/*!
+  * @file sharded_wait_group.h
+  * @brief a wait group for many threads finishing at nearly the same time
+  * @details instead of every done call hitting the one word of csync_wait_group_t, the count is split
+  * @details into per cpu leaves that are refilled from a root word in batches
+*/
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "futex.h"
+#include "sharded_wait_group.h"
+
+/*!
+  * @brief the number of times a thread spins on a taken leaf lock before yielding its cpu
+*/
+#define CSYNC_SHARDED_WAIT_GROUP_SPINS 64
+
+/*!
+  * @brief returns a new sharded wait group with a leaf for every configured cpu
+  * @return Success: an initialized instance of csync_sharded_wait_group_t
+  * @return Failure: NULL if memory couldn't be allocated
+*/
+csync_sharded_wait_group_t *csync_sharded_wait_group_new(void) {
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    csync_sharded_wait_group_t *wg = calloc(1, sizeof(csync_sharded_wait_group_t));
+    if (wg == NULL) {
+        return NULL;
+    }
+    wg->nleaves = ncpus > 0 ? (unsigned int)ncpus : 1;
+    wg->leaves = aligned_alloc(CSYNC_CACHE_LINE, wg->nleaves * sizeof(csync_sharded_wait_group_leaf_t));
+    if (wg->leaves == NULL) {
+        free(wg);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < wg->nleaves; i++) {
+        atomic_init(&wg->leaves[i].lock, 0);
+        atomic_init(&wg->leaves[i].credits, 0);
+    }
+    atomic_init(&wg->root, 0);
+    atomic_init(&wg->waiters, 0);
+    atomic_init(&wg->seq, 0);
+    return wg;
+}
+
+/*!
+  * @brief returns the leaf of the cpu the calling thread is running on
+*/
+static unsigned int csync_sharded_wait_group_index(csync_sharded_wait_group_t *wg) {
+    int cpu = sched_getcpu();
+    return cpu > 0 ? (unsigned int)cpu % wg->nleaves : 0;
+}
+
+static void csync_sharded_wait_group_lock(csync_sharded_wait_group_leaf_t *leaf) {
+    unsigned int spins = 0;
+    while (atomic_exchange_explicit(&leaf->lock, 1, memory_order_acquire) != 0) {
+        while (atomic_load_explicit(&leaf->lock, memory_order_relaxed) != 0) {
+            // the holder may have been preempted, give it a chance to run instead of burning our time slice
+            if (++spins == CSYNC_SHARDED_WAIT_GROUP_SPINS) {
+                spins = 0;
+                sched_yield();
+            }
+            CSYNC_CPU_RELAX();
+        }
+    }
+}
+
+static void csync_sharded_wait_group_unlock(csync_sharded_wait_group_leaf_t *leaf) {
+    atomic_store_explicit(&leaf->lock, 0, memory_order_release);
+}
+
+/*!
+  * @brief moves a batch of credits from the root into an empty leaf, making it a holder
+  * @warning the leaf must be locked by the caller
+  * @return Success: 1
+  * @return Failure: 0 if the root had no credits left
+*/
+static int csync_sharded_wait_group_reserve(csync_sharded_wait_group_t *wg, csync_sharded_wait_group_leaf_t *leaf) {
+    uint64_t root = atomic_load_explicit(&wg->root, memory_order_acquire);
+    for (;;) {
+        uint32_t avail = (uint32_t)(root >> 32);
+        if (avail == 0) {
+            return 0;
+        }
+        // leave enough behind that the other cpus don't have to steal while the root still has credits
+        uint32_t take = avail / (2 * wg->nleaves);
+        if (take == 0) {
+            take = 1;
+        } else if (take > CSYNC_SHARDED_WAIT_GROUP_BATCH) {
+            take = CSYNC_SHARDED_WAIT_GROUP_BATCH;
+        }
+        if (atomic_compare_exchange_weak_explicit(&wg->root, &root, root - ((uint64_t)take << 32) + 1, memory_order_seq_cst, memory_order_acquire)) {
+            atomic_store_explicit(&leaf->credits, take, memory_order_relaxed);
+            return 1;
+        }
+    }
+}
+
+/*!
+  * @brief marks one of the credits of a leaf done, refilling it from the root if it is empty
+  * @param zero set to 1 if this took the last credit of the whole wait group, left alone otherwise
+  * @return Success: 1
+  * @return Failure: 0 if neither the leaf nor the root had any credits
+*/
+static int csync_sharded_wait_group_take(csync_sharded_wait_group_t *wg, csync_sharded_wait_group_leaf_t *leaf, int *zero) {
+    csync_sharded_wait_group_lock(leaf);
+    uint32_t credits = atomic_load_explicit(&leaf->credits, memory_order_relaxed);
+    if (credits == 0) {
+        if (!csync_sharded_wait_group_reserve(wg, leaf)) {
+            csync_sharded_wait_group_unlock(leaf);
+            return 0;
+        }
+        credits = atomic_load_explicit(&leaf->credits, memory_order_relaxed);
+    }
+    atomic_store_explicit(&leaf->credits, credits - 1, memory_order_relaxed);
+    if (credits == 1) {
+        // the leaf stops being a holder, if the root is left with nothing the total is 0
+        if (atomic_fetch_sub_explicit(&wg->root, 1, memory_order_seq_cst) == 1) {
+            *zero = 1;
+        }
+    }
+    csync_sharded_wait_group_unlock(leaf);
+    return 1;
+}
+
+/*!
+  * @brief increments the active count by the given number
+  * @details only touches the root word, so adding the whole count up front is cheaper than adding one at a time
+  * @warning if the part of the count held by the root overflows this is considered a runtime error
+  * @warning and we will exit
+  * @warning adding to a count of 0 while another thread is in csync_sharded_wait_group_wait is not allowed
+*/
+void csync_sharded_wait_group_add(csync_sharded_wait_group_t *wg, unsigned int num) {
+    uint64_t root = atomic_fetch_add_explicit(&wg->root, (uint64_t)num << 32, memory_order_relaxed);
+    if ((root >> 32) + num > UINT32_MAX) {
+        exit(1);
+    }
+}
+
+/*!
+  * @brief decreases the active count typically used to signal a thread is done
+  * @details if the active count is 0 and this is called, it is considered
+  * @details a runtime error and we exit
+*/
+void csync_sharded_wait_group_done(csync_sharded_wait_group_t *wg) {
+    unsigned int index = csync_sharded_wait_group_index(wg);
+    int zero = 0;
+    while (!csync_sharded_wait_group_take(wg, &wg->leaves[index], &zero)) {
+        // the root is empty, so the remaining credits are spread over the other leaves
+        unsigned int i;
+        for (i = 1; i < wg->nleaves; i++) {
+            csync_sharded_wait_group_leaf_t *leaf = &wg->leaves[(index + i) % wg->nleaves];
+            if (atomic_load_explicit(&leaf->credits, memory_order_relaxed) != 0 && csync_sharded_wait_group_take(wg, leaf, &zero)) {
+                break;
+            }
+        }
+        if (i < wg->nleaves) {
+            break;
+        }
+        // no leaf holding credits and nothing in the root means the total already is 0
+        if (atomic_load_explicit(&wg->root, memory_order_acquire) == 0) {
+            exit(1);
+        }
+    }
+    if (zero && atomic_load_explicit(&wg->waiters, memory_order_seq_cst) != 0) {
+        atomic_fetch_add_explicit(&wg->seq, 1, memory_order_release);
+        csync_futex_wake(&wg->seq, INT32_MAX);
+    }
+}
+
+/*!
+  * @brief waits until count reaches 0
+  * @details the calling thread sleeps on a futex and is woken by the done call that drops count to 0
+*/
+void csync_sharded_wait_group_wait(csync_sharded_wait_group_t *wg) {
+    if (atomic_load_explicit(&wg->root, memory_order_acquire) == 0) {
+        return;
+    }
+    // either the final done call sees us registered, or we see the root it emptied
+    atomic_fetch_add_explicit(&wg->waiters, 1, memory_order_seq_cst);
+    for (;;) {
+        uint32_t seq = atomic_load_explicit(&wg->seq, memory_order_seq_cst);
+        if (atomic_load_explicit(&wg->root, memory_order_seq_cst) == 0) {
+            break;
+        }
+        csync_futex_wait(&wg->seq, seq);
+    }
+    atomic_fetch_sub_explicit(&wg->waiters, 1, memory_order_relaxed);
+}
+
+/*!
+  * @brief used to return the number of active actors
+  * @details the leaves are read one after the other, so the result is only exact if no thread is adding or marking done
+  * @return number of active actors
+*/
+unsigned int csync_sharded_wait_group_count(csync_sharded_wait_group_t *wg) {
+    unsigned int count = (unsigned int)(atomic_load_explicit(&wg->root, memory_order_acquire) >> 32);
+    for (unsigned int i = 0; i < wg->nleaves; i++) {
+        count += atomic_load_explicit(&wg->leaves[i].credits, memory_order_relaxed);
+    }
+    return count;
+}
+
+/*!
+  * @brief frees the wait group and its leaves
+  * @warning do not use while other threads are still using the wait group
+*/
+void csync_sharded_wait_group_destroy(csync_sharded_wait_group_t *wg) {
+    free(wg->leaves);
+    free(wg);
+}
\ No newline at end of file
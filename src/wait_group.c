@@ -7,10 +7,13 @@
   * @param wg a declared but uninitialized csync_wait_group_t instance
 */
 
-#include <unistd.h>
-#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+#include "futex.h"
 #include "wait_group.h"
+#include "waitlist.h"
 
 /*!
   * @brief will initialize the given csync_wait_group_t instance
@@ -32,43 +35,109 @@ csync_wait_group_t *csync_wait_group_new(csync_wait_group_t *wg) {
             return NULL;
         }
     }
-    wg->count = 0;
-    pthread_rwlock_init(&wg->mutex, NULL);
+    atomic_init(&wg->state, 0);
+    atomic_init(&wg->sema, 0);
+    csync_waitlist_init(&wg->selects);
     return wg;
 }
 
+/*!
+  * @brief takes one of the wake ups handed out by csync_wait_group_done, sleeping until there is one
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at, NULL to wait forever
+  * @return Success: 0
+  * @return Failure: ETIMEDOUT if abs passed without a wake up to take
+*/
+static int csync_wait_group_sema_acquire(csync_wait_group_t *wg, const struct timespec *abs) {
+    uint32_t tokens = atomic_load_explicit(&wg->sema, memory_order_acquire);
+    for (;;) {
+        if (tokens == 0) {
+            if (csync_futex_wait_until(&wg->sema, 0, abs) == ETIMEDOUT) {
+                return ETIMEDOUT;
+            }
+            tokens = atomic_load_explicit(&wg->sema, memory_order_acquire);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&wg->sema, &tokens, tokens - 1, memory_order_acquire, memory_order_acquire)) {
+            return 0;
+        }
+    }
+}
+
 /*!
   * @brief waits until count reaches 0
   * @details used to wait on different threads/processes
+  * @details the calling thread sleeps on a futex and is woken by the csync_wait_group_done call that drops count to 0
+  * @details returns immediately without any writes if count is already 0
 */
 void csync_wait_group_wait(csync_wait_group_t *wg) {
+    csync_wait_group_wait_until(wg, NULL);
+}
 
-    if (csync_wait_group_count(wg) == 0) {
-        return;
+/*!
+  * @brief waits until count reaches 0, or until ns nanoseconds have passed
+  * @details like csync_wait_group_wait, the calling thread sleeps on a futex instead of polling
+  * @param wg an initialized instance of csync_wait_group_t
+  * @param ns the maximum time to wait for in nanoseconds
+  * @return Success: 0 if count reached 0
+  * @return Failure: ETIMEDOUT if count didn't reach 0 in time
+*/
+int csync_wait_group_wait_timeout(csync_wait_group_t *wg, uint64_t ns) {
+    struct timespec abs;
+    clock_gettime(CLOCK_MONOTONIC, &abs);
+    abs.tv_sec += (time_t)(ns / 1000000000);
+    abs.tv_nsec += (long)(ns % 1000000000);
+    if (abs.tv_nsec >= 1000000000) {
+        abs.tv_sec += 1;
+        abs.tv_nsec -= 1000000000;
     }
-    
+    return csync_wait_group_wait_until(wg, &abs);
+}
+
+/*!
+  * @brief waits until count reaches 0, or until the CLOCK_MONOTONIC clock reaches abs
+  * @details a waiter that times out unregisters itself, so waiting in a loop with short deadlines doesn't leak waiters
+  * @param wg an initialized instance of csync_wait_group_t
+  * @param abs the absolute CLOCK_MONOTONIC time to give up at
+  * @return Success: 0 if count reached 0
+  * @return Failure: ETIMEDOUT if count didn't reach 0 in time
+*/
+int csync_wait_group_wait_until(csync_wait_group_t *wg, const struct timespec *abs) {
+    uint64_t state = atomic_load_explicit(&wg->state, memory_order_acquire);
     for (;;) {
-        // 1000 us == 1 millisecond
-        usleep(50000); // 50 millisecond
-        if (csync_wait_group_count == 0) {
-            return;
+        if ((state >> 32) == 0) {
+            return 0;
+        }
+        // registering only succeeds while count is above 0, so the final done call is guaranteed to see us
+        if (atomic_compare_exchange_weak_explicit(&wg->state, &state, state + 1, memory_order_acquire, memory_order_acquire)) {
+            break;
+        }
+    }
+    if (csync_wait_group_sema_acquire(wg, abs) == 0) {
+        return 0;
+    }
+
+    // unregister, unless the final done call already reset the state and is handing us a wake up
+    state = atomic_load_explicit(&wg->state, memory_order_acquire);
+    while ((state >> 32) != 0) {
+        if (atomic_compare_exchange_weak_explicit(&wg->state, &state, state - 1, memory_order_acquire, memory_order_acquire)) {
+            return ETIMEDOUT;
         }
     }
+    csync_wait_group_sema_acquire(wg, NULL);
+    return 0;
 }
 
 /*!
   * @brief increments the active count by the given number
   * @warning if count + num overflows this is considered a runtime error
   * @warning and we will exit
+  * @warning adding to a count of 0 while another thread is in csync_wait_group_wait is not allowed
 */
 void csync_wait_group_add(csync_wait_group_t *wg, unsigned int num) {
-    unsigned int count = csync_wait_group_count(wg);
-    if (count + num < count) {
+    uint64_t state = atomic_fetch_add_explicit(&wg->state, (uint64_t)num << 32, memory_order_relaxed);
+    if ((state >> 32) + num > UINT32_MAX) {
         exit(1);
     }
-    pthread_rwlock_wrlock(&wg->mutex);
-    wg->count += num;
-    pthread_rwlock_unlock(&wg->mutex);
 }
 
 /*!
@@ -77,13 +146,27 @@ void csync_wait_group_add(csync_wait_group_t *wg, unsigned int num) {
   * @details a runtime error and we exit
 */
 void csync_wait_group_done(csync_wait_group_t *wg) {
-    unsigned int count = csync_wait_group_count(wg);
-    if (count == 0) {
+    uint64_t state = atomic_fetch_sub_explicit(&wg->state, (uint64_t)1 << 32, memory_order_acq_rel);
+    if ((state >> 32) == 0) {
         exit(1);
     }
-    pthread_rwlock_wrlock(&wg->mutex);
-    wg->count -= 1;
-    pthread_rwlock_unlock(&wg->mutex);
+    state -= (uint64_t)1 << 32;
+    uint32_t waiters = (uint32_t)state;
+    if ((state >> 32) != 0 || waiters == 0) {
+        return;
+    }
+
+    // with count at 0 no waiter can register anymore, and adding now would be misuse
+    if (atomic_load_explicit(&wg->state, memory_order_relaxed) != state) {
+        exit(1);
+    }
+    atomic_store_explicit(&wg->state, 0, memory_order_relaxed);
+    // selecting threads count as waiters and take their wake up after removing their node, so fire them first
+    if (csync_waitlist_waiting(&wg->selects)) {
+        csync_waitlist_fire(&wg->selects);
+    }
+    atomic_fetch_add_explicit(&wg->sema, waiters, memory_order_release);
+    csync_futex_wake(&wg->sema, waiters > INT32_MAX ? INT32_MAX : (int)waiters);
 }
 
 /*!
@@ -91,8 +174,39 @@ void csync_wait_group_done(csync_wait_group_t *wg) {
   * @return number of active actors
 */
 unsigned int csync_wait_group_count(csync_wait_group_t *wg) {
-    pthread_rwlock_rdlock(&wg->mutex);
-    unsigned int count = wg->count;
-    pthread_rwlock_unlock(&wg->mutex);
-    return count;
+    return (unsigned int)(atomic_load_explicit(&wg->state, memory_order_acquire) >> 32);
+}
+
+/*!
+  * @brief adds a csync_select node to the wait group, which counts as a waiter until it is removed again
+  * @return 1 if count is already 0, in which case the node isn't added
+*/
+int csync_wait_group_select_add(csync_wait_group_t *wg, csync_waitlist_node_t *node) {
+    csync_waitlist_add(&wg->selects, node);
+    uint64_t state = atomic_load_explicit(&wg->state, memory_order_acquire);
+    for (;;) {
+        if ((state >> 32) == 0) {
+            csync_waitlist_remove(node);
+            return 1;
+        }
+        if (atomic_compare_exchange_weak_explicit(&wg->state, &state, state + 1, memory_order_acq_rel, memory_order_acquire)) {
+            return 0;
+        }
+    }
+}
+
+/*!
+  * @brief removes a node added by csync_wait_group_select_add
+  * @details like a timed out waiter, takes the wake up of the final done call if it already reset the count,
+  * @details so that call is done with the wait group before the selecting thread returns
+*/
+void csync_wait_group_select_remove(csync_wait_group_t *wg, csync_waitlist_node_t *node) {
+    csync_waitlist_remove(node);
+    uint64_t state = atomic_load_explicit(&wg->state, memory_order_acquire);
+    while ((state >> 32) != 0) {
+        if (atomic_compare_exchange_weak_explicit(&wg->state, &state, state - 1, memory_order_acquire, memory_order_acquire)) {
+            return;
+        }
+    }
+    csync_wait_group_sema_acquire(wg, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*!
+  * @file waitlist.h
+  * @brief the threads waiting on a primitive through csync_select
+  * @details every csync_cond_t and csync_wait_group_t keeps one, a thread selecting on several of them
+  * @details adds a node to each list and sleeps on a single futex word, which the first primitive to fire sets
+*/
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "futex.h"
+#include "waitlist.h"
+
+/*!
+  * @brief the number of times the lock is checked before yielding the cpu to its holder
+*/
+#define CSYNC_WAITLIST_SPINS 64
+
+/*!
+  * @brief initializes an empty list
+*/
+void csync_waitlist_init(csync_waitlist_t *list) {
+    atomic_init(&list->lock, 0);
+    atomic_init(&list->count, 0);
+    list->head = NULL;
+}
+
+static void csync_waitlist_lock(csync_waitlist_t *list) {
+    while (atomic_exchange_explicit(&list->lock, 1, memory_order_acquire)) {
+        for (unsigned int i = 0; atomic_load_explicit(&list->lock, memory_order_relaxed); i++) {
+            if (i < CSYNC_WAITLIST_SPINS) {
+                CSYNC_CPU_RELAX();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+static void csync_waitlist_unlock(csync_waitlist_t *list) {
+    atomic_store_explicit(&list->lock, 0, memory_order_release);
+}
+
+/*!
+  * @brief adds node to list
+  * @details is followed by a seq_cst fence, so after checking its condition a thread either saw the change
+  * @details or the thread that made it sees the node, as long as that one fences before csync_waitlist_waiting
+*/
+void csync_waitlist_add(csync_waitlist_t *list, csync_waitlist_node_t *node) {
+    csync_waitlist_lock(list);
+    node->list = list;
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head != NULL) {
+        list->head->prev = node;
+    }
+    list->head = node;
+    atomic_fetch_add_explicit(&list->count, 1, memory_order_relaxed);
+    csync_waitlist_unlock(list);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+/*!
+  * @brief removes node from the list it was added to, once this returns it is no longer touched by csync_waitlist_fire
+*/
+void csync_waitlist_remove(csync_waitlist_node_t *node) {
+    csync_waitlist_t *list = node->list;
+    csync_waitlist_lock(list);
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        list->head = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+    atomic_fetch_sub_explicit(&list->count, 1, memory_order_relaxed);
+    csync_waitlist_unlock(list);
+}
+
+/*!
+  * @brief wakes every thread with a node on the list, unless another primitive woke it first
+  * @return the number of threads woken
+*/
+unsigned int csync_waitlist_fire(csync_waitlist_t *list) {
+    unsigned int woken = 0;
+    csync_waitlist_lock(list);
+    // the lock keeps the selecting thread from returning, and its futex word from going away, until we are done
+    for (csync_waitlist_node_t *node = list->head; node != NULL; node = node->next) {
+        uint32_t fired = 0;
+        if (atomic_compare_exchange_strong_explicit(node->fired, &fired, node->id + 1, memory_order_release, memory_order_relaxed)) {
+            csync_futex_wake(node->fired, 1);
+            woken++;
+        }
+    }
+    csync_waitlist_unlock(list);
+    return woken;
+}
\ No newline at end of file
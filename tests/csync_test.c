@@ -1,14 +1,30 @@
 #include <stdio.h>
+#include <errno.h>
 #include <assert.h>
 #include <stdarg.h>
 #include <stddef.h>
 #include <setjmp.h>
 #include <cmocka.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include "wait_group.h"
+#include "sharded_wait_group.h"
+#include "errgroup.h"
 #include "cond.h"
+#include "event.h"
+#include "eventcount.h"
+#include "mutex.h"
+#include "rwmutex.h"
+#include "once.h"
+#include "map.h"
+#include "chan.h"
+#include "select.h"
 #include "pool.h"
+#include "bufpool.h"
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
@@ -35,6 +51,94 @@ void *csync_pool_test_fn(void *data) {
   pthread_exit(NULL);
 }
 
+void *csync_pool_batch_test_fn(void *data) {
+  csync_pool_t *pool = (csync_pool_t *)data;
+  object_test_t *objs[CSYNC_POOL_LOCAL_SIZE * 2];
+
+  for (int i = 0; i < 20; i++) {
+    // borrow more objects than fit into the thread cache so the shared tier is used
+    for (int j = 0; j < CSYNC_POOL_LOCAL_SIZE * 2; j++) {
+      objs[j] = (object_test_t *)csync_pool_get(pool);
+      assert(objs[j] != NULL);
+      objs[j]->a = (int)pthread_self();
+      objs[j]->b = j;
+    }
+    // no other thread may have been handed the same object
+    for (int j = 0; j < CSYNC_POOL_LOCAL_SIZE * 2; j++) {
+      assert(objs[j]->a == (int)pthread_self());
+      assert(objs[j]->b == j);
+    }
+    for (int j = 0; j < CSYNC_POOL_LOCAL_SIZE * 2; j++) {
+      csync_pool_put(pool, objs[j]);
+    }
+  }
+
+  pthread_exit(NULL);
+}
+
+/*!
+  * @brief borrows 8 objects and returns them, handing them to the shared tier on exit
+*/
+void *csync_pool_trim_test_fn(void *data) {
+  csync_pool_t *pool = (csync_pool_t *)data;
+  void *objs[8];
+  for (int i = 0; i < 8; i++) {
+    objs[i] = csync_pool_get(pool);
+  }
+  for (int i = 0; i < 8; i++) {
+    csync_pool_put(pool, objs[i]);
+  }
+  pthread_exit(NULL);
+}
+
+/*!
+  * @brief shared between the producer and consumer of test_csync_pool_remote
+*/
+typedef struct remote_test {
+  csync_pool_t *pool;
+  void *objs[8];
+  pthread_barrier_t barrier;
+  int reused;
+} remote_test_t;
+
+/*!
+  * @brief gets objects that are put back by the main thread, and then gets them again
+*/
+void *csync_pool_remote_test_fn(void *data) {
+  remote_test_t *test = (remote_test_t *)data;
+  for (int i = 0; i < 8; i++) {
+    test->objs[i] = csync_pool_get(test->pool);
+  }
+  // use up our cache so the next get has to refill it
+  csync_pool_slab_t *slab = (csync_pool_slab_t *)((uintptr_t)test->objs[0] & ~(uintptr_t)(test->pool->slab_size - 1));
+  csync_pool_local_t *local = slab->owner;
+  void *cached[CSYNC_POOL_LOCAL_SIZE];
+  unsigned int count = 0;
+  while (local->count > 0) {
+    cached[count] = csync_pool_get(test->pool);
+    count += 1;
+  }
+  pthread_barrier_wait(&test->barrier);
+  pthread_barrier_wait(&test->barrier);
+
+  // the objects the main thread put are returned to us instead of staying in its cache
+  void *objs[8];
+  test->reused = 0;
+  for (int i = 0; i < 8; i++) {
+    objs[i] = csync_pool_get(test->pool);
+    for (int j = 0; j < 8; j++) {
+      test->reused += objs[i] == test->objs[j];
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    csync_pool_put(test->pool, objs[i]);
+  }
+  for (unsigned int i = 0; i < count; i++) {
+    csync_pool_put(test->pool, cached[i]);
+  }
+  pthread_exit(NULL);
+}
+
 void *csync_cond_test_fn(void *data) {
   csync_cond_t *cond = (csync_cond_t *)data;
   csync_cond_wait(cond);
@@ -43,11 +147,17 @@ void *csync_cond_test_fn(void *data) {
   pthread_exit(NULL);
 }
 
+_Atomic int freed_object_test = 0;
+
 void free_object_test(void *obj) {
+  freed_object_test += 1;
   free((object_test_t *)obj);
 }
 
+_Atomic int allocated_object_test = 0;
+
 void *new_object_test() {
+  allocated_object_test += 1;
   object_test_t *obj = calloc(1, sizeof(object_test_t));
   assert(obj != NULL);
   obj->a = 0;
@@ -60,7 +170,6 @@ void test_csync_wait_group_new(void **state) {
   csync_wait_group_new(&wg);
   csync_wait_group_add(&wg, 1);
   csync_wait_group_done(&wg);
-  pthread_rwlock_destroy(&wg.mutex);
 }
 
 void test_csync_wait_group_new_null(void **state) {
@@ -68,10 +177,206 @@ void test_csync_wait_group_new_null(void **state) {
   assert(wg != NULL);
   csync_wait_group_add(wg, 1);
   csync_wait_group_done(wg);
-  pthread_rwlock_destroy(&wg->mutex);
   free(wg);
 }
 
+void *csync_wait_group_test_fn(void *data) {
+  csync_wait_group_t *wg = (csync_wait_group_t *)data;
+  usleep(1000);
+  csync_wait_group_done(wg);
+  pthread_exit(NULL);
+}
+
+void *csync_wait_group_waiter_fn(void *data) {
+  csync_wait_group_t *wg = (csync_wait_group_t *)data;
+  csync_wait_group_wait(wg);
+  assert(csync_wait_group_count(wg) == 0);
+  pthread_exit(NULL);
+}
+
+void test_csync_wait_group_waiters(void **state) {
+  csync_wait_group_t wg;
+  csync_wait_group_new(&wg);
+
+  // every waiter of a round is woken up once, and the wait group can be reused afterwards
+  for (int i = 0; i < 20; i++) {
+    pthread_t waiters[4];
+    pthread_t workers[16];
+    csync_wait_group_add(&wg, 16);
+    for (int j = 0; j < 4; j++) {
+      pthread_create(&waiters[j], NULL, csync_wait_group_waiter_fn, &wg);
+    }
+    for (int j = 0; j < 16; j++) {
+      pthread_create(&workers[j], NULL, csync_wait_group_test_fn, &wg);
+    }
+    for (int j = 0; j < 4; j++) {
+      pthread_join(waiters[j], NULL);
+    }
+    for (int j = 0; j < 16; j++) {
+      pthread_join(workers[j], NULL);
+    }
+    assert(wg.state == 0);
+    assert(wg.sema == 0);
+  }
+}
+
+void test_csync_wait_group_timeout(void **state) {
+  csync_wait_group_t wg;
+  csync_wait_group_new(&wg);
+  assert(csync_wait_group_wait_timeout(&wg, 0) == 0);
+
+  csync_wait_group_add(&wg, 1);
+  assert(csync_wait_group_wait_timeout(&wg, 1000000) == ETIMEDOUT);
+  // a waiter that timed out doesn't stay registered
+  assert(wg.state == (uint64_t)1 << 32);
+
+  struct timespec past;
+  clock_gettime(CLOCK_MONOTONIC, &past);
+  assert(csync_wait_group_wait_until(&wg, &past) == ETIMEDOUT);
+
+  // waiting in a loop with short timeouts until the worker is done
+  pthread_t thread;
+  pthread_create(&thread, NULL, csync_wait_group_test_fn, &wg);
+  int rc;
+  while ((rc = csync_wait_group_wait_timeout(&wg, 100000)) == ETIMEDOUT) {
+  }
+  assert(rc == 0);
+  assert(csync_wait_group_count(&wg) == 0);
+  pthread_join(thread, NULL);
+  assert(wg.state == 0);
+  assert(wg.sema == 0);
+}
+
+void test_csync_wait_group_wait(void **state) {
+  csync_wait_group_t wg;
+  csync_wait_group_new(&wg);
+  // nothing to wait for
+  csync_wait_group_wait(&wg);
+
+  pthread_t threads[8];
+  for (int i = 0; i < 3; i++) {
+    csync_wait_group_add(&wg, 8);
+    for (int j = 0; j < 8; j++) {
+      pthread_create(&threads[j], NULL, csync_wait_group_test_fn, &wg);
+    }
+    csync_wait_group_wait(&wg);
+    assert(csync_wait_group_count(&wg) == 0);
+    for (int j = 0; j < 8; j++) {
+      pthread_join(threads[j], NULL);
+    }
+  }
+}
+
+void *csync_sharded_wait_group_test_fn(void *data) {
+  csync_sharded_wait_group_t *wg = (csync_sharded_wait_group_t *)data;
+  for (int i = 0; i < 1000; i++) {
+    csync_sharded_wait_group_done(wg);
+  }
+  pthread_exit(NULL);
+}
+
+void *csync_sharded_wait_group_waiter_fn(void *data) {
+  csync_sharded_wait_group_t *wg = (csync_sharded_wait_group_t *)data;
+  csync_sharded_wait_group_wait(wg);
+  assert(csync_sharded_wait_group_count(wg) == 0);
+  pthread_exit(NULL);
+}
+
+void test_csync_sharded_wait_group(void **state) {
+  csync_sharded_wait_group_t *wg = csync_sharded_wait_group_new();
+  assert(wg != NULL);
+  // nothing to wait for
+  csync_sharded_wait_group_wait(wg);
+
+  csync_sharded_wait_group_add(wg, 3);
+  assert(csync_sharded_wait_group_count(wg) == 3);
+  csync_sharded_wait_group_done(wg);
+  assert(csync_sharded_wait_group_count(wg) == 2);
+  csync_sharded_wait_group_done(wg);
+  csync_sharded_wait_group_done(wg);
+  assert(csync_sharded_wait_group_count(wg) == 0);
+  assert(wg->root == 0);
+
+  // the workers drain each other's leaves once the root is empty, and only the last one wakes the waiters
+  for (int i = 0; i < 10; i++) {
+    pthread_t waiters[4];
+    pthread_t workers[8];
+    csync_sharded_wait_group_add(wg, 8 * 1000);
+    for (int j = 0; j < 4; j++) {
+      pthread_create(&waiters[j], NULL, csync_sharded_wait_group_waiter_fn, wg);
+    }
+    for (int j = 0; j < 8; j++) {
+      pthread_create(&workers[j], NULL, csync_sharded_wait_group_test_fn, wg);
+    }
+    for (int j = 0; j < 4; j++) {
+      pthread_join(waiters[j], NULL);
+    }
+    for (int j = 0; j < 8; j++) {
+      pthread_join(workers[j], NULL);
+    }
+    assert(wg->root == 0);
+    for (unsigned int j = 0; j < wg->nleaves; j++) {
+      assert(wg->leaves[j].credits == 0);
+    }
+  }
+  csync_sharded_wait_group_destroy(wg);
+}
+
+int csync_errgroup_ok_fn(csync_errgroup_t *eg, void *arg) {
+  usleep(1000);
+  atomic_fetch_add((_Atomic int *)arg, 1);
+  return 0;
+}
+
+int csync_errgroup_fail_fn(csync_errgroup_t *eg, void *arg) {
+  return EIO;
+}
+
+int csync_errgroup_poll_fn(csync_errgroup_t *eg, void *arg) {
+  while (!csync_errgroup_cancelled(eg)) {
+    usleep(100);
+  }
+  atomic_fetch_add((_Atomic int *)arg, 1);
+  return ETIMEDOUT;
+}
+
+void test_csync_errgroup(void **state) {
+  _Atomic int count = 0;
+  csync_errgroup_t *eg = csync_errgroup_new();
+  assert(eg != NULL);
+  // nothing to wait for
+  assert(csync_errgroup_wait(eg) == 0);
+  for (int i = 0; i < 8; i++) {
+    assert(csync_errgroup_go(eg, csync_errgroup_ok_fn, &count) == 0);
+  }
+  assert(csync_errgroup_wait(eg) == 0);
+  assert(count == 8);
+  assert(!csync_errgroup_cancelled(eg));
+  csync_errgroup_destroy(eg);
+
+  // the first error cancels the group and wait returns it while the pollers may still be running
+  count = 0;
+  eg = csync_errgroup_new();
+  assert(eg != NULL);
+  for (int i = 0; i < 4; i++) {
+    assert(csync_errgroup_go(eg, csync_errgroup_poll_fn, &count) == 0);
+  }
+  assert(csync_errgroup_go(eg, csync_errgroup_fail_fn, NULL) == 0);
+  assert(csync_errgroup_wait(eg) == EIO);
+  assert(csync_errgroup_cancelled(eg));
+  assert(csync_errgroup_go(eg, csync_errgroup_ok_fn, &count) == ECANCELED);
+  // later errors don't replace the first one
+  csync_errgroup_cancel(eg, EPERM);
+  csync_errgroup_destroy(eg);
+  assert(count == 4);
+
+  eg = csync_errgroup_new();
+  assert(eg != NULL);
+  csync_errgroup_cancel(eg, 0);
+  assert(csync_errgroup_wait(eg) == ECANCELED);
+  csync_errgroup_destroy(eg);
+}
+
 void test_csync_cond_new(void **state) {
   csync_cond_t cond;
   csync_cond_new(&cond);
@@ -111,6 +416,751 @@ void test_csync_cond_new_null(void **state) {
   pthread_join(thread2, NULL);
 }
 
+typedef struct cond_test {
+  csync_cond_t cond;
+  int ready;
+  int woken;
+} cond_test_t;
+
+int csync_cond_test_ready(void *arg) {
+  return ((cond_test_t *)arg)->ready;
+}
+
+int csync_cond_test_set_ready(void *arg) {
+  ((cond_test_t *)arg)->ready = 1;
+  return -1;
+}
+
+int csync_cond_test_count_woken(void *arg) {
+  ((cond_test_t *)arg)->woken++;
+  return 0;
+}
+
+void *csync_cond_wait_until_fn(void *data) {
+  cond_test_t *test = (cond_test_t *)data;
+  csync_cond_wait_until(&test->cond, csync_cond_test_ready, test);
+  csync_cond_locked(&test->cond, csync_cond_test_count_woken, test);
+  pthread_exit(NULL);
+}
+
+void test_csync_cond_wait_until(void **state) {
+  cond_test_t test = {.ready = 0, .woken = 0};
+  csync_cond_new(&test.cond);
+
+  assert(csync_cond_wait_until_timeout(&test.cond, csync_cond_test_ready, &test, 1000000) == ETIMEDOUT);
+  struct timespec past;
+  clock_gettime(CLOCK_MONOTONIC, &past);
+  assert(csync_cond_wait_until_deadline(&test.cond, csync_cond_test_ready, &test, &past) == ETIMEDOUT);
+
+  // no sleeping needed, waiters starting after the broadcast see the predicate hold right away
+  pthread_t threads[4];
+  for (int i = 0; i < 2; i++) {
+    pthread_create(&threads[i], NULL, csync_cond_wait_until_fn, &test);
+  }
+  csync_cond_locked(&test.cond, csync_cond_test_set_ready, &test);
+  for (int i = 2; i < 4; i++) {
+    pthread_create(&threads[i], NULL, csync_cond_wait_until_fn, &test);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(test.woken == 4);
+  assert(csync_cond_wait_until_timeout(&test.cond, csync_cond_test_ready, &test, 0) == 0);
+  pthread_cond_destroy(&test.cond.cond);
+  pthread_mutex_destroy(&test.cond.mutex);
+}
+
+int csync_cond_test_take(void *arg) {
+  cond_test_t *test = (cond_test_t *)arg;
+  if (test->ready == 0) {
+    return 0;
+  }
+  test->ready--;
+  return 1;
+}
+
+int csync_cond_test_add_two(void *arg) {
+  ((cond_test_t *)arg)->ready += 2;
+  return 0;
+}
+
+void *csync_cond_take_fn(void *data) {
+  cond_test_t *test = (cond_test_t *)data;
+  csync_cond_wait_until(&test->cond, csync_cond_test_take, test);
+  pthread_exit(NULL);
+}
+
+void test_csync_cond_notify_n(void **state) {
+  cond_test_t test = {.ready = 0, .woken = 0};
+  csync_cond_new(&test.cond);
+  // nobody to wake
+  assert(csync_cond_notify_n(&test.cond, 4) == 0);
+  csync_cond_signal(&test.cond);
+  csync_cond_broadcast(&test.cond);
+
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&threads[i], NULL, csync_cond_take_fn, &test);
+  }
+  while (atomic_load(&test.cond.waiters) != 4) {
+    usleep(100);
+  }
+  // wake exactly as many waiters as there are tokens
+  csync_cond_locked(&test.cond, csync_cond_test_add_two, &test);
+  assert(csync_cond_notify_n(&test.cond, 2) == 2);
+  while (atomic_load(&test.cond.waiters) != 2) {
+    usleep(100);
+  }
+  csync_cond_locked(&test.cond, csync_cond_test_add_two, &test);
+  csync_cond_broadcast(&test.cond);
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(test.ready == 0);
+  assert(test.cond.waiters == 0);
+  pthread_cond_destroy(&test.cond.cond);
+  pthread_mutex_destroy(&test.cond.mutex);
+}
+
+typedef struct event_test {
+  csync_event_t ping;
+  csync_event_t pong;
+  int rounds;
+} event_test_t;
+
+void *csync_event_test_fn(void *data) {
+  event_test_t *test = (event_test_t *)data;
+  for (int i = 0; i < test->rounds; i++) {
+    csync_event_wait(&test->ping);
+    csync_event_reset(&test->ping);
+    csync_event_set(&test->pong);
+  }
+  pthread_exit(NULL);
+}
+
+void test_csync_event(void **state) {
+  csync_event_t *ev = csync_event_new(NULL);
+  assert(ev != NULL);
+  assert(!csync_event_is_set(ev));
+  struct timespec past;
+  clock_gettime(CLOCK_MONOTONIC, &past);
+  assert(csync_event_wait_until(ev, &past) == ETIMEDOUT);
+  csync_event_set(ev);
+  assert(csync_event_is_set(ev));
+  // a set event lets every waiter through until it is reset
+  csync_event_wait(ev);
+  assert(csync_event_wait_until(ev, &past) == 0);
+  csync_event_reset(ev);
+  assert(!csync_event_is_set(ev));
+  free(ev);
+
+  // ping pong both with spinning and with parking right away
+  for (unsigned int spins = 0; spins <= CSYNC_EVENT_SPINS; spins += CSYNC_EVENT_SPINS) {
+    event_test_t test = {.rounds = 1000};
+    csync_event_new(&test.ping);
+    csync_event_new(&test.pong);
+    csync_event_set_spins(&test.ping, spins);
+    csync_event_set_spins(&test.pong, spins);
+    pthread_t thread;
+    pthread_create(&thread, NULL, csync_event_test_fn, &test);
+    for (int i = 0; i < test.rounds; i++) {
+      csync_event_set(&test.ping);
+      csync_event_wait(&test.pong);
+      csync_event_reset(&test.pong);
+    }
+    pthread_join(thread, NULL);
+    assert(!csync_event_is_set(&test.ping));
+  }
+}
+
+typedef struct eventcount_test {
+  csync_eventcount_t ec;
+  _Atomic int items;
+  _Atomic int taken;
+} eventcount_test_t;
+
+int csync_eventcount_test_take(eventcount_test_t *test) {
+  int items = atomic_load(&test->items);
+  while (items > 0) {
+    if (atomic_compare_exchange_weak(&test->items, &items, items - 1)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void *csync_eventcount_consumer_fn(void *data) {
+  eventcount_test_t *test = (eventcount_test_t *)data;
+  for (int i = 0; i < 1000; i++) {
+    while (!csync_eventcount_test_take(test)) {
+      uint32_t key = csync_eventcount_prepare_wait(&test->ec);
+      if (csync_eventcount_test_take(test)) {
+        csync_eventcount_cancel_wait(&test->ec);
+        break;
+      }
+      csync_eventcount_commit_wait(&test->ec, key);
+    }
+    atomic_fetch_add(&test->taken, 1);
+  }
+  pthread_exit(NULL);
+}
+
+void *csync_eventcount_producer_fn(void *data) {
+  eventcount_test_t *test = (eventcount_test_t *)data;
+  for (int i = 0; i < 1000; i++) {
+    atomic_fetch_add(&test->items, 1);
+    csync_eventcount_notify(&test->ec);
+  }
+  pthread_exit(NULL);
+}
+
+void test_csync_eventcount(void **state) {
+  eventcount_test_t test;
+  csync_eventcount_new(&test.ec);
+  atomic_init(&test.items, 0);
+  atomic_init(&test.taken, 0);
+
+  // a notify between prepare and commit isn't missed
+  uint32_t key = csync_eventcount_prepare_wait(&test.ec);
+  csync_eventcount_notify(&test.ec);
+  csync_eventcount_commit_wait(&test.ec, key);
+  key = csync_eventcount_prepare_wait(&test.ec);
+  struct timespec past;
+  clock_gettime(CLOCK_MONOTONIC, &past);
+  assert(csync_eventcount_commit_wait_until(&test.ec, key, &past) == ETIMEDOUT);
+  // without waiters notifying doesn't touch the epoch
+  uint32_t epoch = test.ec.epoch;
+  csync_eventcount_notify(&test.ec);
+  csync_eventcount_notify_all(&test.ec);
+  assert(test.ec.epoch == epoch);
+  assert(test.ec.waiters == 0);
+
+  pthread_t consumers[4];
+  pthread_t producers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&consumers[i], NULL, csync_eventcount_consumer_fn, &test);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&producers[i], NULL, csync_eventcount_producer_fn, &test);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(producers[i], NULL);
+    pthread_join(consumers[i], NULL);
+  }
+  assert(test.taken == 4000);
+  assert(test.items == 0);
+  assert(test.ec.waiters == 0);
+}
+
+typedef struct mutex_test {
+  csync_mutex_t mutex;
+  unsigned int counter;
+  unsigned int iterations;
+  unsigned int hold_us;
+} mutex_test_t;
+
+void *csync_mutex_test_fn(void *data) {
+  mutex_test_t *test = (mutex_test_t *)data;
+  for (unsigned int i = 0; i < test->iterations; i++) {
+    csync_mutex_lock(&test->mutex);
+    test->counter++;
+    if (test->hold_us != 0) {
+      usleep(test->hold_us);
+    }
+    csync_mutex_unlock(&test->mutex);
+  }
+  pthread_exit(NULL);
+}
+
+void test_csync_mutex(void **state) {
+  csync_mutex_t *mutex = csync_mutex_new(NULL);
+  assert(mutex != NULL);
+  assert(csync_mutex_trylock(mutex) == 0);
+  assert(csync_mutex_trylock(mutex) == EBUSY);
+  csync_mutex_unlock(mutex);
+  csync_mutex_lock(mutex);
+  assert(mutex->state == CSYNC_MUTEX_LOCKED);
+  csync_mutex_unlock(mutex);
+  assert(mutex->state == 0);
+  free(mutex);
+
+  // short critical sections, and ones long enough for waiters to starve and get the mutex handed to them
+  unsigned int iterations[2] = {20000, 20};
+  unsigned int hold_us[2] = {0, 1500};
+  for (int mode = 0; mode < 2; mode++) {
+    mutex_test_t test = {.counter = 0, .iterations = iterations[mode], .hold_us = hold_us[mode]};
+    csync_mutex_new(&test.mutex);
+    pthread_t threads[8];
+    for (int i = 0; i < 8; i++) {
+      pthread_create(&threads[i], NULL, csync_mutex_test_fn, &test);
+    }
+    for (int i = 0; i < 8; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    assert(test.counter == 8 * iterations[mode]);
+    assert(test.mutex.state == 0);
+    assert(test.mutex.sema == 0);
+  }
+}
+
+typedef struct rwmutex_test {
+  csync_rwmutex_t *rw;
+  unsigned int a;
+  unsigned int b;
+} rwmutex_test_t;
+
+void *csync_rwmutex_reader_fn(void *data) {
+  rwmutex_test_t *test = (rwmutex_test_t *)data;
+  for (int i = 0; i < 20000; i++) {
+    csync_rwmutex_rlock(test->rw);
+    assert(test->a == test->b);
+    csync_rwmutex_runlock(test->rw);
+  }
+  pthread_exit(NULL);
+}
+
+void *csync_rwmutex_writer_fn(void *data) {
+  rwmutex_test_t *test = (rwmutex_test_t *)data;
+  for (int i = 0; i < 2000; i++) {
+    csync_rwmutex_lock(test->rw);
+    test->a++;
+    test->b++;
+    csync_rwmutex_unlock(test->rw);
+  }
+  pthread_exit(NULL);
+}
+
+int64_t csync_rwmutex_test_readers(csync_rwmutex_t *rw) {
+  int64_t readers = 0;
+  for (unsigned int i = 0; i < rw->nslots; i++) {
+    readers += rw->slots[i].readers;
+  }
+  return readers;
+}
+
+void test_csync_rwmutex(void **state) {
+  rwmutex_test_t test = {.a = 0, .b = 0};
+  test.rw = csync_rwmutex_new();
+  assert(test.rw != NULL);
+  // read locks nest, the write lock excludes everyone
+  csync_rwmutex_rlock(test.rw);
+  csync_rwmutex_rlock(test.rw);
+  assert(csync_rwmutex_test_readers(test.rw) == 2);
+  csync_rwmutex_runlock(test.rw);
+  csync_rwmutex_runlock(test.rw);
+  csync_rwmutex_lock(test.rw);
+  assert(test.rw->writer == CSYNC_RWMUTEX_WRITER);
+  csync_rwmutex_unlock(test.rw);
+
+  pthread_t readers[6];
+  pthread_t writers[2];
+  for (int i = 0; i < 6; i++) {
+    pthread_create(&readers[i], NULL, csync_rwmutex_reader_fn, &test);
+  }
+  for (int i = 0; i < 2; i++) {
+    pthread_create(&writers[i], NULL, csync_rwmutex_writer_fn, &test);
+  }
+  for (int i = 0; i < 6; i++) {
+    pthread_join(readers[i], NULL);
+  }
+  for (int i = 0; i < 2; i++) {
+    pthread_join(writers[i], NULL);
+  }
+  assert(test.a == 4000);
+  assert(test.b == 4000);
+  assert(csync_rwmutex_test_readers(test.rw) == 0);
+  assert(test.rw->writer == CSYNC_RWMUTEX_FREE);
+  csync_rwmutex_destroy(test.rw);
+}
+
+typedef struct once_test {
+  csync_once_t once;
+  _Atomic int calls;
+  _Atomic int failures;
+  int value;
+} once_test_t;
+
+void csync_once_test_init(void *arg) {
+  once_test_t *test = (once_test_t *)arg;
+  atomic_fetch_add(&test->calls, 1);
+  usleep(1000);
+  test->value = 42;
+}
+
+int csync_once_test_try_init(void *arg) {
+  once_test_t *test = (once_test_t *)arg;
+  atomic_fetch_add(&test->calls, 1);
+  usleep(1000);
+  // the first two runs fail
+  if (atomic_fetch_add(&test->failures, 1) < 2) {
+    return EIO;
+  }
+  test->value = 42;
+  return 0;
+}
+
+void *csync_once_do_fn(void *data) {
+  once_test_t *test = (once_test_t *)data;
+  csync_once_do(&test->once, csync_once_test_init, test);
+  assert(test->value == 42);
+  pthread_exit(NULL);
+}
+
+void *csync_once_try_fn(void *data) {
+  once_test_t *test = (once_test_t *)data;
+  while (csync_once_try(&test->once, csync_once_test_try_init, test) != 0) {
+  }
+  assert(test->value == 42);
+  pthread_exit(NULL);
+}
+
+void test_csync_once(void **state) {
+  static csync_once_t static_once = CSYNC_ONCE_INIT;
+  once_test_t test = {.calls = 0, .failures = 0, .value = 0};
+  csync_once_do(&static_once, csync_once_test_init, &test);
+  csync_once_do(&static_once, csync_once_test_init, &test);
+  assert(test.calls == 1);
+  assert(static_once.state == CSYNC_ONCE_DONE);
+
+  // concurrent first callers wait for the winner instead of running fn themselves
+  void *(*fns[2])(void *) = {csync_once_do_fn, csync_once_try_fn};
+  int calls[2] = {1, 3};
+  for (int mode = 0; mode < 2; mode++) {
+    test.calls = 0;
+    test.failures = 0;
+    test.value = 0;
+    csync_once_new(&test.once);
+    pthread_t threads[8];
+    for (int i = 0; i < 8; i++) {
+      pthread_create(&threads[i], NULL, fns[mode], &test);
+    }
+    for (int i = 0; i < 8; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    assert(test.calls == calls[mode]);
+    assert(test.once.state == CSYNC_ONCE_DONE);
+  }
+
+  // a failed run is retried by the next call
+  csync_once_new(&test.once);
+  test.failures = 0;
+  assert(csync_once_try(&test.once, csync_once_test_try_init, &test) == EIO);
+  assert(test.once.state == CSYNC_ONCE_NEW);
+  assert(csync_once_try(&test.once, csync_once_test_try_init, &test) == EIO);
+  assert(csync_once_try(&test.once, csync_once_test_try_init, &test) == 0);
+  assert(csync_once_try(&test.once, csync_once_test_try_init, &test) == 0);
+  assert(test.failures == 3);
+}
+
+
+typedef struct map_test {
+  csync_map_t *map;
+  _Atomic uintptr_t base;
+  _Atomic int failures;
+} map_test_t;
+
+/*!
+  * @brief keys below 256 are never written while the test runs, so they must always be found
+*/
+void *csync_map_reader_fn(void *data) {
+  map_test_t *test = (map_test_t *)data;
+  for (int n = 0; n < 20000; n++) {
+    uintptr_t key = (uintptr_t)(n % 256);
+    void *value = NULL;
+    if (!csync_map_load(test->map, (void *)key, &value) || value != (void *)(key + 1)) {
+      atomic_fetch_add(&test->failures, 1);
+    }
+  }
+  return NULL;
+}
+
+/*!
+  * @brief stores, replaces and deletes keys only this thread uses, growing the table along the way
+*/
+void *csync_map_writer_fn(void *data) {
+  map_test_t *test = (map_test_t *)data;
+  uintptr_t base = atomic_fetch_add(&test->base, 1000);
+  for (int round = 0; round < 4; round++) {
+    for (uintptr_t key = base; key < base + 1000; key++) {
+      assert(csync_map_store(test->map, (void *)key, (void *)key) == 0);
+      assert(csync_map_store(test->map, (void *)key, (void *)(key + 1)) == 0);
+    }
+    for (uintptr_t key = base; key < base + 1000; key++) {
+      void *value = NULL;
+      assert(csync_map_load(test->map, (void *)key, &value) == 1);
+      assert(value == (void *)(key + 1));
+      assert(csync_map_delete(test->map, (void *)key, NULL) == 1);
+    }
+  }
+  return NULL;
+}
+
+uint64_t csync_map_test_hash(const void *key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char *c = key; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+int csync_map_test_eq(const void *a, const void *b) {
+  return strcmp(a, b) == 0;
+}
+
+int csync_map_test_sum(const void *key, void *value, void *arg) {
+  *(uintptr_t *)arg += (uintptr_t)value;
+  return 1;
+}
+
+void test_csync_map(void **state) {
+  csync_map_t *map = csync_map_new(NULL, NULL);
+  assert(map != NULL);
+  void *value = NULL;
+  assert(csync_map_load(map, (void *)1, &value) == 0);
+  // enough keys to grow the table several times
+  for (uintptr_t key = 0; key < 5000; key++) {
+    assert(csync_map_store(map, (void *)key, (void *)(key + 1)) == 0);
+  }
+  assert(csync_map_len(map) == 5000);
+  for (uintptr_t key = 0; key < 5000; key++) {
+    assert(csync_map_load(map, (void *)key, &value) == 1);
+    assert(value == (void *)(key + 1));
+  }
+  assert(csync_map_load_or_store(map, (void *)7, (void *)100, &value) == EEXIST);
+  assert(value == (void *)8);
+  assert(csync_map_load_or_store(map, (void *)5000, (void *)100, &value) == 0);
+  assert(value == (void *)100);
+  assert(csync_map_delete(map, (void *)5000, &value) == 1);
+  assert(value == (void *)100);
+  assert(csync_map_delete(map, (void *)5000, NULL) == 0);
+  for (uintptr_t key = 256; key < 5000; key++) {
+    assert(csync_map_delete(map, (void *)key, NULL) == 1);
+  }
+  assert(csync_map_len(map) == 256);
+  uintptr_t sum = 0;
+  csync_map_range(map, csync_map_test_sum, &sum);
+  assert(sum == 256 * 257 / 2);
+
+  // lookups of untouched keys never fail while other threads grow and shrink the map
+  map_test_t test = {.map = map, .base = 1000, .failures = 0};
+  pthread_t threads[8];
+  for (int i = 0; i < 8; i++) {
+    pthread_create(&threads[i], NULL, i % 2 ? csync_map_reader_fn : csync_map_writer_fn, &test);
+  }
+  for (int i = 0; i < 8; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(test.failures == 0);
+  assert(csync_map_len(map) == 256);
+  csync_map_destroy(map);
+
+  // keys compared by content
+  map = csync_map_new(csync_map_test_hash, csync_map_test_eq);
+  assert(map != NULL);
+  char key[] = "session";
+  assert(csync_map_store(map, "session", (void *)1) == 0);
+  assert(csync_map_load(map, key, &value) == 1);
+  assert(value == (void *)1);
+  assert(csync_map_load(map, "other", NULL) == 0);
+  csync_map_destroy(map);
+}
+
+
+typedef struct chan_test {
+  csync_chan_t *ch;
+  _Atomic unsigned long sum;
+  _Atomic unsigned long count;
+} chan_test_t;
+
+/*!
+  * @brief sends 1 to 2000, every other thread in batches
+*/
+void *csync_chan_sender_fn(void *data) {
+  chan_test_t *test = (chan_test_t *)data;
+  static _Atomic int batch = 0;
+  if (atomic_fetch_add(&batch, 1) % 2) {
+    void *values[50];
+    for (uintptr_t i = 0; i < 2000; i += 50) {
+      for (uintptr_t j = 0; j < 50; j++) {
+        values[j] = (void *)(i + j + 1);
+      }
+      assert(csync_chan_send_batch(test->ch, values, 50) == 50);
+    }
+  } else {
+    for (uintptr_t i = 1; i <= 2000; i++) {
+      assert(csync_chan_send(test->ch, (void *)i) == 0);
+    }
+  }
+  return NULL;
+}
+
+/*!
+  * @brief receives until the channel is closed and drained
+*/
+void *csync_chan_receiver_fn(void *data) {
+  chan_test_t *test = (chan_test_t *)data;
+  void *values[16];
+  for (;;) {
+    size_t n = csync_chan_recv_batch(test->ch, values, 16);
+    if (n == 0) {
+      break;
+    }
+    for (size_t i = 0; i < n; i++) {
+      atomic_fetch_add(&test->sum, (uintptr_t)values[i]);
+    }
+    atomic_fetch_add(&test->count, n);
+    void *value;
+    int rc = csync_chan_recv(test->ch, &value);
+    if (rc == EPIPE) {
+      break;
+    }
+    assert(rc == 0);
+    atomic_fetch_add(&test->sum, (uintptr_t)value);
+    atomic_fetch_add(&test->count, 1);
+  }
+  return NULL;
+}
+
+void test_csync_chan(void **state) {
+  assert(csync_chan_new(0) == NULL);
+  csync_chan_t *ch = csync_chan_new(3);
+  assert(ch != NULL);
+  assert(csync_chan_cap(ch) == 4);
+  void *value = NULL;
+  assert(csync_chan_try_recv(ch, &value) == EAGAIN);
+  for (uintptr_t i = 1; i <= 4; i++) {
+    assert(csync_chan_try_send(ch, (void *)i) == 0);
+  }
+  assert(csync_chan_try_send(ch, (void *)5) == EAGAIN);
+  assert(csync_chan_len(ch) == 4);
+  struct timespec abs;
+  clock_gettime(CLOCK_MONOTONIC, &abs);
+  abs.tv_nsec += 1000000;
+  if (abs.tv_nsec >= 1000000000) {
+    abs.tv_sec++;
+    abs.tv_nsec -= 1000000000;
+  }
+  assert(csync_chan_send_until(ch, (void *)5, &abs) == ETIMEDOUT);
+  assert(csync_chan_recv(ch, &value) == 0);
+  assert(value == (void *)1);
+
+  // values sent before closing are still received, in order
+  assert(csync_chan_close(ch) == 0);
+  assert(csync_chan_close(ch) == EPIPE);
+  assert(csync_chan_try_send(ch, (void *)5) == EPIPE);
+  void *values[8];
+  assert(csync_chan_recv_batch(ch, values, 8) == 3);
+  assert(values[0] == (void *)2 && values[1] == (void *)3 && values[2] == (void *)4);
+  assert(csync_chan_try_recv(ch, &value) == EPIPE);
+  assert(csync_chan_recv_until(ch, &value, &abs) == EPIPE);
+  assert(csync_chan_recv_batch(ch, values, 8) == 0);
+  csync_chan_destroy(ch);
+
+  // every value sent by 4 senders is received exactly once by 4 receivers through a small channel
+  chan_test_t test = {.sum = 0, .count = 0};
+  test.ch = csync_chan_new(8);
+  pthread_t senders[4];
+  pthread_t receivers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&senders[i], NULL, csync_chan_sender_fn, &test);
+    pthread_create(&receivers[i], NULL, csync_chan_receiver_fn, &test);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(senders[i], NULL);
+  }
+  assert(csync_chan_close(test.ch) == 0);
+  for (int i = 0; i < 4; i++) {
+    pthread_join(receivers[i], NULL);
+  }
+  assert(test.count == 4 * 2000);
+  assert(test.sum == 4 * 2000 * 2001 / 2);
+  csync_chan_destroy(test.ch);
+}
+
+
+typedef struct select_test {
+  cond_test_t conds[20];
+  csync_wait_group_t wg;
+  csync_select_case_t cases[21];
+  size_t fired;
+} select_test_t;
+
+void *csync_select_test_fn(void *data) {
+  select_test_t *test = (select_test_t *)data;
+  assert(csync_select(test->cases, 21, NULL, &test->fired) == 0);
+  pthread_exit(NULL);
+}
+
+void test_csync_select(void **state) {
+  select_test_t test;
+  for (int i = 0; i < 20; i++) {
+    test.conds[i].ready = 0;
+    test.conds[i].woken = 0;
+    csync_cond_new(&test.conds[i].cond);
+    test.cases[i] = (csync_select_case_t)CSYNC_SELECT_COND_CASE(&test.conds[i].cond, csync_cond_test_ready, &test.conds[i]);
+  }
+  csync_wait_group_new(&test.wg);
+  csync_wait_group_add(&test.wg, 1);
+  test.cases[20] = (csync_select_case_t)CSYNC_SELECT_WAIT_GROUP_CASE(&test.wg);
+
+  size_t fired = 0;
+  assert(csync_select(test.cases, 0, NULL, &fired) == EINVAL);
+  assert(csync_select_timeout(test.cases, 2, 1000000, &fired) == ETIMEDOUT);
+  assert(csync_select_timeout(test.cases, 21, 1000000, &fired) == ETIMEDOUT);
+
+  // with several cases ready, each of them gets picked
+  test.conds[0].ready = 1;
+  test.conds[1].ready = 1;
+  int picked[2] = {0, 0};
+  for (int i = 0; i < 100; i++) {
+    assert(csync_select_timeout(test.cases, 3, 0, &fired) == 0);
+    assert(fired < 2);
+    picked[fired]++;
+  }
+  assert(picked[0] > 0 && picked[1] > 0);
+  test.conds[0].ready = 0;
+  test.conds[1].ready = 0;
+
+  // a blocked select reports the single source that became ready, notifications without it are ignored
+  pthread_t thread;
+  pthread_create(&thread, NULL, csync_select_test_fn, &test);
+  usleep(10000);
+  csync_cond_locked(&test.conds[3].cond, csync_cond_test_count_woken, &test.conds[3]);
+  csync_cond_broadcast(&test.conds[7].cond);
+  usleep(10000);
+  csync_cond_locked(&test.conds[17].cond, csync_cond_test_set_ready, &test.conds[17]);
+  pthread_join(thread, NULL);
+  assert(test.fired == 17);
+  test.conds[17].ready = 0;
+
+  pthread_create(&thread, NULL, csync_select_test_fn, &test);
+  usleep(10000);
+  csync_wait_group_done(&test.wg);
+  pthread_join(thread, NULL);
+  assert(test.fired == 20);
+
+  // every registration was removed again
+  for (int i = 0; i < 20; i++) {
+    assert(csync_cond_notify_n(&test.conds[i].cond, 1) == 0);
+    pthread_cond_destroy(&test.conds[i].cond.cond);
+    pthread_mutex_destroy(&test.conds[i].cond.mutex);
+  }
+  assert(atomic_load(&test.wg.selects.count) == 0);
+  assert(atomic_load(&test.wg.state) == 0);
+}
+
+
+/*!
+  * @brief counts the objects stored in the pool, including those cached by threads
+  * @warning only valid while no other thread is using the pool
+*/
+unsigned int csync_pool_test_idle(csync_pool_t *pool) {
+  unsigned int count = pool->count;
+  for (csync_pool_local_t *local = pool->locals; local != NULL; local = local->next) {
+    count += local->count;
+  }
+  return count;
+}
 
 void test_csync_pool(void **state) {
   csync_pool_t *pool = csync_pool_new(10, new_object_test, free_object_test);
@@ -132,19 +1182,20 @@ void test_csync_pool(void **state) {
 
   // put the first object back
   csync_pool_put(pool, obj);
-  assert(pool->count == 1);
+  assert(csync_pool_test_idle(pool) == 1);
+  assert(pool->locals != NULL && pool->locals->next == NULL);
 
   // this should return the already created object
   obj = (object_test_t *)csync_pool_get(pool);
   assert(obj->a == 1);
   assert(obj->b == 2);
 
-  assert(pool->count == 0);
+  assert(csync_pool_test_idle(pool) == 0);
 
   // put both objects back
   csync_pool_put(pool, obj);
   csync_pool_put(pool, obj2);
-  assert(pool->count == 2);
+  assert(csync_pool_test_idle(pool) == 2);
 
   pthread_t thread1;
   pthread_t thread2;
@@ -155,8 +1206,10 @@ void test_csync_pool(void **state) {
   pthread_join(thread1, NULL);
   pthread_join(thread2, NULL);
 
-  // ensure that we still only have 2 objects which means they were all reused
-  assert(pool->count == 2);
+  // the 2 objects are cached by this thread, so each worker created at most one object
+  // which it reused, and handed back to the shared tier when it exited
+  assert(csync_pool_test_idle(pool) >= 3);
+  assert(csync_pool_test_idle(pool) <= 4);
 
 
   // remove objects so further tests create new objects
@@ -180,19 +1233,550 @@ void test_csync_pool(void **state) {
   csync_pool_put(pool, obj);
   csync_pool_put(pool, obj2);
 
-  assert(pool->count > 2);
-  printf("count: %u\n", pool->count);
+  assert(csync_pool_test_idle(pool) > 2);
+  printf("count: %u\n", csync_pool_test_idle(pool));
+
+  csync_pool_destroy(pool);
+}
+
+void test_csync_pool_local(void **state) {
+  csync_pool_t *pool = csync_pool_new(1, new_object_test, free_object_test);
+  assert(pool != NULL);
+
+  object_test_t *objs[CSYNC_POOL_LOCAL_SIZE + 1];
+  for (int i = 0; i < CSYNC_POOL_LOCAL_SIZE + 1; i++) {
+    objs[i] = csync_pool_get(pool);
+    assert(objs[i] != NULL);
+  }
+
+  // filling the thread cache shouldn't touch the shared tier
+  for (int i = 0; i < CSYNC_POOL_LOCAL_SIZE; i++) {
+    csync_pool_put(pool, objs[i]);
+  }
+  assert(pool->count == 0);
+
+  // overflowing it spills the oldest half into the shared tier
+  csync_pool_put(pool, objs[CSYNC_POOL_LOCAL_SIZE]);
+  assert(pool->count == CSYNC_POOL_LOCAL_SIZE / 2);
+  assert(csync_pool_test_idle(pool) == CSYNC_POOL_LOCAL_SIZE + 1);
+
+  // the most recently returned object is handed out first
+  object_test_t *obj = csync_pool_get(pool);
+  assert(obj == objs[CSYNC_POOL_LOCAL_SIZE]);
+  csync_pool_put(pool, obj);
+
+  // objects cached by exited threads end up in the shared tier
+  pthread_t thread;
+  pthread_create(&thread, NULL, csync_pool_test_fn, pool);
+  pthread_join(thread, NULL);
+  assert(csync_pool_test_idle(pool) == CSYNC_POOL_LOCAL_SIZE + 1);
+  assert(pool->count == CSYNC_POOL_LOCAL_SIZE / 2);
+
+  // a pool reusing the id of a destroyed one doesn't see its cache
+  unsigned int id = pool->id;
+  csync_pool_destroy(pool);
+  pool = csync_pool_new(1, new_object_test, free_object_test);
+  assert(pool->id == id);
+  assert(csync_pool_test_idle(pool) == 0);
+  obj = csync_pool_get(pool);
+  csync_pool_put(pool, obj);
+  assert(csync_pool_test_idle(pool) == 1);
+  assert(pool->locals != NULL && pool->locals->next == NULL);
+  csync_pool_destroy(pool);
+
+  // pools share a single pthread key, so there can be more of them than keys
+  csync_pool_t **pools = calloc(PTHREAD_KEYS_MAX + 1, sizeof(csync_pool_t *));
+  for (int i = 0; i < PTHREAD_KEYS_MAX + 1; i++) {
+    pools[i] = csync_pool_new(1, new_object_test, free_object_test);
+    assert(pools[i] != NULL);
+    csync_pool_put(pools[i], csync_pool_get(pools[i]));
+  }
+  for (int i = 0; i < PTHREAD_KEYS_MAX + 1; i++) {
+    csync_pool_destroy(pools[i]);
+  }
+  free(pools);
+}
+
+void test_csync_pool_lockfree(void **state) {
+  csync_pool_t *pool = csync_pool_new_ex(1, new_object_test, free_object_test, CSYNC_POOL_LOCKFREE);
+  assert(pool != NULL);
+
+  object_test_t *obj = (object_test_t *)csync_pool_get(pool);
+  assert(obj != NULL);
+  obj->a = 1;
+  csync_pool_put(pool, obj);
+  obj = (object_test_t *)csync_pool_get(pool);
+  assert(obj->a == 1);
+  csync_pool_put(pool, obj);
+
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&threads[i], NULL, csync_pool_batch_test_fn, pool);
+  }
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // every worker returned its objects to the shared tier growing the node storage
+  assert(pool->nchunks > 1);
+
+  csync_pool_destroy(pool);
+}
+
+void test_csync_pool_fixed(void **state) {
+  // align must be a power of two
+  assert(csync_pool_new_fixed(sizeof(object_test_t), 24, 16, 0) == NULL);
+
+  int flags[2] = {0, CSYNC_POOL_LOCKFREE};
+  for (int i = 0; i < 2; i++) {
+    csync_pool_t *pool = csync_pool_new_fixed(sizeof(object_test_t), 64, 16, flags[i]);
+    assert(pool != NULL);
+    assert(pool->obj_size == 64);
+    assert(pool->slab_size == CSYNC_POOL_SLAB_SIZE);
+
+    // objects are zeroed, aligned, and carved out of the same slab one after another
+    object_test_t *obj = (object_test_t *)csync_pool_get(pool);
+    object_test_t *obj2 = (object_test_t *)csync_pool_get(pool);
+    assert(obj != NULL && obj2 != NULL);
+    assert(obj->a == 0 && obj->b == 0);
+    assert(((uintptr_t)obj & 63) == 0);
+    assert((char *)obj2 - (char *)obj == 64 || (char *)obj - (char *)obj2 == 64);
+    assert(((uintptr_t)obj & ~(uintptr_t)(pool->slab_size - 1)) == (uintptr_t)pool->slabs);
+
+    obj->a = 1;
+    csync_pool_put(pool, obj);
+    assert((object_test_t *)csync_pool_get(pool) == obj);
+    assert(obj->a == 1);
+    csync_pool_put(pool, obj);
+    csync_pool_put(pool, obj2);
+
+    // spread objects over multiple slabs, and through the shared tier
+    pthread_t threads[4];
+    for (int j = 0; j < 4; j++) {
+      pthread_create(&threads[j], NULL, csync_pool_batch_test_fn, pool);
+    }
+    for (int j = 0; j < 4; j++) {
+      pthread_join(threads[j], NULL);
+    }
+
+    object_test_t *objs[CSYNC_POOL_SLAB_SIZE / 64];
+    for (int j = 0; j < CSYNC_POOL_SLAB_SIZE / 64; j++) {
+      objs[j] = (object_test_t *)csync_pool_get(pool);
+      assert(objs[j] != NULL);
+    }
+    assert(pool->slabs->next != NULL);
+    for (int j = 0; j < CSYNC_POOL_SLAB_SIZE / 64; j++) {
+      csync_pool_put(pool, objs[j]);
+    }
+
+    csync_pool_destroy(pool);
+  }
+}
+
+void test_csync_pool_trim(void **state) {
+  int flags[2] = {0, CSYNC_POOL_LOCKFREE};
+  for (int i = 0; i < 2; i++) {
+    csync_pool_t *pool = csync_pool_new_ex(4, new_object_test, free_object_test, flags[i]);
+    assert(pool != NULL);
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+
+    // the first trim only moves the objects to the victim generation
+    freed_object_test = 0;
+    csync_pool_trim(pool);
+    assert(freed_object_test == 0);
+
+    // objects that are reused in between two trims survive them
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    csync_pool_trim(pool);
+    assert(freed_object_test == 0);
+
+    csync_pool_trim(pool);
+    assert(freed_object_test == 8);
+
+    // the ticker frees idle objects on its own
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    assert(csync_pool_ticker_start(pool, 10) == 0);
+    assert(csync_pool_ticker_start(pool, 10) == EBUSY);
+    for (int j = 0; j < 200 && freed_object_test != 16; j++) {
+      usleep(5000);
+    }
+    assert(freed_object_test == 16);
+    csync_pool_ticker_stop(pool);
+
+    csync_pool_destroy(pool);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    csync_pool_t *pool = csync_pool_new_fixed(sizeof(object_test_t), 0, 16, flags[i]);
+    assert(pool != NULL);
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    assert(pool->slabs != NULL);
+
+    // slabs are only freed once all of their objects are idle for two trims
+    csync_pool_trim(pool);
+    assert(pool->slabs != NULL);
+    csync_pool_trim(pool);
+    assert(pool->slabs == NULL);
+
+    // a new slab is carved once the old one is gone
+    void *obj = csync_pool_get(pool);
+    assert(obj != NULL);
+    assert(pool->slabs != NULL);
+
+    // the slab still has objects in use, so it can't be freed
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    csync_pool_trim(pool);
+    csync_pool_trim(pool);
+    assert(pool->slabs != NULL);
+    csync_pool_put(pool, obj);
+
+    csync_pool_destroy(pool);
+  }
+}
+
+void test_csync_pool_batch(void **state) {
+  csync_pool_t *pools[3] = {
+    csync_pool_new(4, new_object_test, free_object_test),
+    csync_pool_new_ex(4, new_object_test, free_object_test, CSYNC_POOL_LOCKFREE),
+    csync_pool_new_fixed(sizeof(object_test_t), 0, 16, 0),
+  };
+  for (int i = 0; i < 3; i++) {
+    csync_pool_t *pool = pools[i];
+    assert(pool != NULL);
+
+    object_test_t *objs[64];
+    csync_pool_get_n(pool, (void **)objs, 64);
+    for (int j = 0; j < 64; j++) {
+      assert(objs[j] != NULL);
+      assert(objs[j]->a == 0);
+      objs[j]->a = 1;
+    }
+    // more objects than fit into the thread cache end up in the shared tier
+    csync_pool_put_n(pool, (void **)objs, 64);
+
+    // all of the objects are reused
+    object_test_t *objs2[64];
+    csync_pool_get_n(pool, (void **)objs2, 64);
+    for (int j = 0; j < 64; j++) {
+      int found = 0;
+      for (int k = 0; k < 64; k++) {
+        found += objs2[j] == objs[k];
+      }
+      assert(found == 1);
+    }
+    csync_pool_put_n(pool, (void **)objs2, 64);
+
+    csync_pool_destroy(pool);
+  }
+}
+
+void test_csync_pool_prewarm(void **state) {
+  csync_pool_t *pool = csync_pool_new(4, new_object_test, free_object_test);
+  assert(pool != NULL);
+
+  allocated_object_test = 0;
+  assert(csync_pool_prewarm(pool, 100, 4) == 100);
+  assert(allocated_object_test == 100);
+  assert(pool->count == 100);
+
+  // the prewarmed objects are used instead of creating new ones
+  object_test_t *objs[100];
+  csync_pool_get_n(pool, (void **)objs, 100);
+  assert(allocated_object_test == 100);
+  csync_pool_put_n(pool, (void **)objs, 100);
+  csync_pool_destroy(pool);
+
+  pool = csync_pool_new_fixed(sizeof(object_test_t), 0, 16, CSYNC_POOL_LOCKFREE);
+  assert(pool != NULL);
+  assert(csync_pool_prewarm(pool, 10000, 3) == 10000);
+  assert(pool->slabs != NULL);
+  csync_pool_destroy(pool);
+}
+
+/*!
+  * @brief trims the pool, used to contend on its mutex
+*/
+void *csync_pool_trim_fn(void *data) {
+  csync_pool_trim((csync_pool_t *)data);
+  return NULL;
+}
+
+void test_csync_pool_stats(void **state) {
+#if !CSYNC_POOL_STATS
+  return;
+#endif
+  int flags[2] = {0, CSYNC_POOL_LOCKFREE};
+  for (int i = 0; i < 2; i++) {
+    csync_pool_t *pool = csync_pool_new_ex(1, new_object_test, free_object_test, flags[i]);
+    assert(pool != NULL);
+    csync_pool_stats_t stats;
+
+    void *objs[64];
+    csync_pool_get_n(pool, objs, 64);
+    csync_pool_stats(pool, &stats);
+    assert(stats.gets == 64);
+    assert(stats.misses == 64);
+    assert(stats.idle == 0);
+
+    // half of the objects don't fit into the thread cache and grow the shared tier
+    csync_pool_put_n(pool, objs, 64);
+    csync_pool_stats(pool, &stats);
+    assert(stats.puts == 64);
+    assert(stats.idle == 64);
+    assert(stats.shared_idle == 32);
+    assert(stats.shared_peak_idle == 32);
+    assert(stats.resizes >= 1);
+
+    // the counters of exited threads are kept
+    pthread_t thread;
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    csync_pool_stats(pool, &stats);
+    assert(stats.gets == 72);
+    assert(stats.puts == 72);
+    assert(stats.misses == 64);
+    assert(stats.idle == 64);
+
+    // only the shared tier is trimmed, the objects cached by this thread stay
+    csync_pool_trim(pool);
+    csync_pool_trim(pool);
+    csync_pool_stats(pool, &stats);
+    assert(stats.frees == 32);
+    assert(stats.idle == 32);
+    assert(stats.shared_idle == 0);
+    assert(stats.shared_peak_idle == 32);
+
+    // waiting for the mutex is accounted on every path taking it, trimming included
+    csync_lock_lock(&pool->mutex);
+    pthread_create(&thread, NULL, csync_pool_trim_fn, pool);
+    usleep(20000);
+    csync_lock_unlock(&pool->mutex);
+    pthread_join(thread, NULL);
+    uint64_t waited = stats.lock_wait_ns;
+    csync_pool_stats(pool, &stats);
+    assert(stats.lock_wait_ns >= waited + 10000000);
+
+    csync_pool_destroy(pool);
+  }
 
+  // fixed size pools create a batch of objects per miss
+  csync_pool_t *pool = csync_pool_new_fixed(sizeof(object_test_t), 0, 16, 0);
+  assert(pool != NULL);
+  void *obj = csync_pool_get(pool);
+  csync_pool_stats_t stats;
+  csync_pool_stats(pool, &stats);
+  assert(stats.gets == 1);
+  assert(stats.misses == CSYNC_POOL_LOCAL_SIZE / 2);
+  assert(stats.idle == CSYNC_POOL_LOCAL_SIZE / 2 - 1);
+  assert(stats.resizes == 1);
+  csync_pool_put(pool, obj);
   csync_pool_destroy(pool);
 }
 
+void test_csync_pool_hugepages(void **state) {
+  int flags[2] = {CSYNC_POOL_HUGEPAGES, CSYNC_POOL_HUGEPAGES | CSYNC_POOL_LOCKFREE};
+  for (int i = 0; i < 2; i++) {
+    csync_pool_t *pool = csync_pool_new_fixed(sizeof(object_test_t), 0, 16, flags[i]);
+    assert(pool != NULL);
+    assert(pool->slab_size >= CSYNC_POOL_HUGEPAGE_SIZE);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, pool);
+    pthread_join(thread, NULL);
+    csync_pool_slab_t *slab = pool->slabs;
+    assert(slab != NULL);
+    assert(((uintptr_t)slab & (pool->slab_size - 1)) == 0);
+
+    // trimmed arenas are decommitted but kept around
+    csync_pool_trim(pool);
+    csync_pool_trim(pool);
+    assert(pool->slabs == NULL);
+    if (slab->mapped) {
+      assert(pool->decommitted == slab);
+    }
+
+    // and carved from again, handing out zeroed objects
+    object_test_t *obj = csync_pool_get(pool);
+    assert(obj != NULL);
+    assert(obj->a == 0 && obj->b == 0);
+    assert(pool->slabs == slab);
+    assert(pool->decommitted == NULL);
+    csync_pool_put(pool, obj);
+
+    csync_pool_destroy(pool);
+  }
+}
+
+void test_csync_pool_remote(void **state) {
+  int flags[2] = {0, CSYNC_POOL_LOCKFREE};
+  for (int i = 0; i < 2; i++) {
+    remote_test_t test;
+    test.pool = csync_pool_new_fixed(sizeof(object_test_t), 0, 16, flags[i]);
+    assert(test.pool != NULL);
+    pthread_barrier_init(&test.barrier, NULL, 2);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, csync_pool_remote_test_fn, &test);
+    pthread_barrier_wait(&test.barrier);
+    csync_pool_slab_t *slab = test.pool->slabs;
+    assert(slab->owner != NULL);
+    csync_pool_put_n(test.pool, test.objs, 4);
+    for (int j = 4; j < 8; j++) {
+      csync_pool_put(test.pool, test.objs[j]);
+    }
+    pthread_barrier_wait(&test.barrier);
+    pthread_join(thread, NULL);
+    assert(test.reused == 8);
+    // the producer never had to carve a second slab
+    assert(test.pool->slabs == slab);
+
+    // objects of exited threads are kept by whoever puts them
+    void *obj = csync_pool_get(test.pool);
+    assert(obj != NULL);
+    csync_pool_put(test.pool, obj);
+
+    // a new thread adopts the cache of the exited one
+    pthread_create(&thread, NULL, csync_pool_trim_test_fn, test.pool);
+    pthread_join(thread, NULL);
+    unsigned int locals = 0;
+    for (csync_pool_local_t *local = test.pool->locals; local != NULL; local = local->next) {
+      locals += 1;
+    }
+    assert(locals == 2);
+
+    pthread_barrier_destroy(&test.barrier);
+    csync_pool_destroy(test.pool);
+  }
+}
+
+void test_csync_pool_cap(void **state) {
+  csync_pool_t *pool = csync_pool_new(4, new_object_test, free_object_test);
+  assert(pool != NULL);
+  csync_pool_set_cap(pool, 4);
+
+  // at most 4 objects are cached by this thread and 4 in the shared tier, the rest is freed
+  void *objs[16];
+  freed_object_test = 0;
+  csync_pool_get_n(pool, objs, 16);
+  csync_pool_put_n(pool, objs, 16);
+  assert(freed_object_test == 8);
+  assert(pool->count == 4);
+
+  // without an alloc_fn nothing is created on a miss
+  csync_pool_t *empty = csync_pool_new(4, NULL, free);
+  assert(empty != NULL);
+  assert(csync_pool_get(empty) == NULL);
+  csync_pool_destroy(empty);
+
+  csync_pool_destroy(pool);
+}
+
+void test_csync_bufpool(void **state) {
+  csync_bufpool_t *bufpool = csync_bufpool_new(500, 64 * 1024, 0);
+  assert(bufpool != NULL);
+  assert(bufpool->nclasses == 8);
+  assert(csync_bufpool_new(4096, 512, 0) == NULL);
+
+  char *small = csync_bufpool_get(bufpool, 1);
+  assert(small != NULL);
+  assert(csync_bufpool_size(small) == 512);
+  assert((uintptr_t)small % _Alignof(max_align_t) == 0);
+  char *medium = csync_bufpool_get(bufpool, 513);
+  assert(csync_bufpool_size(medium) == 1024);
+  char *large = csync_bufpool_get(bufpool, 64 * 1024);
+  assert(csync_bufpool_size(large) == 64 * 1024);
+  // too large for any class, allocated on its own
+  char *huge = csync_bufpool_get(bufpool, 100000);
+  assert(huge != NULL);
+  assert(csync_bufpool_size(huge) == 100000);
+  memset(small, 1, 512);
+  memset(medium, 2, 1024);
+  memset(large, 3, 64 * 1024);
+  memset(huge, 4, 100000);
+
+  csync_bufpool_put(bufpool, small);
+  csync_bufpool_put(bufpool, medium);
+  csync_bufpool_put(bufpool, large);
+  csync_bufpool_put(bufpool, huge);
+  csync_bufpool_put(bufpool, NULL);
+
+  // buffers are reused by any length of the same class
+  assert(csync_bufpool_get(bufpool, 1000) == medium);
+  assert(csync_bufpool_get(bufpool, 200) == small);
+  assert(csync_bufpool_get(bufpool, 40000) == large);
+  csync_bufpool_put(bufpool, small);
+  csync_bufpool_put(bufpool, medium);
+  csync_bufpool_put(bufpool, large);
+
+  // the cap of a class limits how many buffers it keeps
+  csync_bufpool_set_cap(bufpool, 2048, 1);
+  char *bufs[8];
+  for (int i = 0; i < 8; i++) {
+    bufs[i] = csync_bufpool_get(bufpool, 2048);
+  }
+  for (int i = 0; i < 8; i++) {
+    csync_bufpool_put(bufpool, bufs[i]);
+  }
+  csync_pool_stats_t stats;
+  csync_bufpool_stats(bufpool, 2048, &stats);
+  assert(stats.idle <= 2);
+#if CSYNC_POOL_STATS
+  // the class never had a buffer stored, so all of them were misses counted by the buffer pool
+  assert(stats.misses == 8);
+  assert(stats.gets == 8);
+  assert(stats.puts == 8);
+  csync_bufpool_stats(bufpool, 1000, &stats);
+  assert(stats.misses == 1);
+  assert(stats.gets == 2);
+#endif
+  csync_bufpool_stats(bufpool, 100000, &stats);
+  assert(stats.gets == 0);
+
+  csync_bufpool_destroy(bufpool);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_csync_wait_group_new),
         cmocka_unit_test(test_csync_wait_group_new_null),
+        cmocka_unit_test(test_csync_wait_group_wait),
+        cmocka_unit_test(test_csync_sharded_wait_group),
+        cmocka_unit_test(test_csync_errgroup),
+        cmocka_unit_test(test_csync_wait_group_waiters),
+        cmocka_unit_test(test_csync_wait_group_timeout),
         cmocka_unit_test(test_csync_cond_new),
         cmocka_unit_test(test_csync_cond_new_null),
-        cmocka_unit_test(test_csync_pool)
+        cmocka_unit_test(test_csync_cond_wait_until),
+        cmocka_unit_test(test_csync_cond_notify_n),
+        cmocka_unit_test(test_csync_event),
+        cmocka_unit_test(test_csync_eventcount),
+        cmocka_unit_test(test_csync_mutex),
+        cmocka_unit_test(test_csync_rwmutex),
+        cmocka_unit_test(test_csync_once),
+        cmocka_unit_test(test_csync_map),
+        cmocka_unit_test(test_csync_chan),
+        cmocka_unit_test(test_csync_select),
+        cmocka_unit_test(test_csync_pool),
+        cmocka_unit_test(test_csync_pool_local),
+        cmocka_unit_test(test_csync_pool_lockfree),
+        cmocka_unit_test(test_csync_pool_fixed),
+        cmocka_unit_test(test_csync_pool_trim),
+        cmocka_unit_test(test_csync_pool_batch),
+        cmocka_unit_test(test_csync_pool_prewarm),
+        cmocka_unit_test(test_csync_pool_stats),
+        cmocka_unit_test(test_csync_pool_hugepages),
+        cmocka_unit_test(test_csync_pool_remote),
+        cmocka_unit_test(test_csync_pool_cap),
+        cmocka_unit_test(test_csync_bufpool)
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }